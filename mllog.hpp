@@ -9,6 +9,71 @@
  *      - GitHub: https://github.com/mixml
  *
  * 变更摘要（关键）：
+ * @version 2.10.0
+ *      - 性能：新增异步模式 setAsync(on, queueCapacity)：调用线程格式化后拷贝进有界无锁 MPSC 队列的预分配槽位，
+ *        专用写线程批量写文件/上屏；热路径不再争用 _mutex、不等待 I/O。flush() 会等待已入队记录写完。
+ *      - 可靠性：异步队列溢出策略 setAsyncOverflow(Block/DropNewest/DropOldest/Spill)；丢弃数由写线程合成
+ *        "N records dropped" 行输出，getAsyncDroppedCount() 查询累计值；Spill 沿用 pending 的字节/条数上限淘汰。
+ *        Block 先短暂让出 CPU，之后在条件变量上睡眠，由写线程腾出空位时唤醒，不再忙等。
+ *      - 性能：setAsync(on, cap, AsyncQueue::PerThread)：每线程独立 SPSC 字节环（setAsyncThreadBufferSize），
+ *        写线程轮询所有已登记的线程环并按时间戳归并后写出，生产者之间无共享缓存行；线程退出后其环排空即摘除并释放。放不进线程环的超长记录经溢出缓冲
+ *        交给写线程（其后的记录随之排在溢出缓冲中直到写出），不在调用线程同步写。
+ *      - 性能：setDeferredFormat(true)（异步模式下）：LoggerStream 只把参数按值编码为二进制（ML_ArgCodec），
+ *        连同调用点/时间戳/线程号入队，正文渲染与前缀/Pattern 格式化全部在写线程完成。
+ *      - 性能：日志宏为每个调用点生成 static const ML_Logger::CallSite（文件/函数/行/级别/格式串），调用时只传指针；
+ *        CallSite::id() 提供进程内唯一编号；原有 log/logformat(file, full, func, line, ...) 接口保留。
+ *      - 性能：编译期开关 MLLOG_ACTIVE_LEVEL（MLLOG_LEVEL_DEBUG..MLLOG_LEVEL_OFF），低于该级别的宏在优化构建中整体消除；
+ *        运行期宏先调用 shouldLog(lv)，级别关闭时不构造 LoggerStream、不求值 << 参数与 printf 参数。
+ *      - 性能：命名宏在调用点缓存 ML_Logger*（ML_Logger::getCached，名字不变时仅一次比较）；Registry 读路径改为
+ *        无锁快照（写时复制）；ML_Logger::get() 缓存 default 实例。
+ *      - 性能：setPattern 编译为不可变的 CompiledPattern_ 并原子发布，渲染不再持 _mutex；%n 在编译时并入字面量，
+ *        getpid() 仅在含 %P 时调用。
+ *      - 性能：Pattern 的时间片段在 %e 处切开，DateChunk 的 strftime 结果按线程、按秒缓存，每行只拼接毫秒。
+ *      - 性能：LoggerStream 改用栈上 ML_SmallBuf<512>（超长才落堆）；新增 log(..., const char*, size_t, bool) 免拷贝入口，
+ *        截断仅在超长时复制；常规短日志从构造到写出全程零堆分配。
+ *      - 性能：logformat 直接格式化到 1KB 栈缓冲，超出时用线程私有缓冲（容量复用，超过 64KB 时用完即释放），
+ *        不再 vector+string 多次拷贝。
+ *      - 性能：整数改用两位查表格式化，浮点默认可往返（C++17 to_chars 取最短；否则 m/10^k 形式的短小数直接输出、其余一次 %.17g）；
+ *        默认前缀与 Pattern 的行号/毫秒/线程号不再经过 snprintf。新增 ml_precision(n) 控制流式浮点有效位数。
+ *      - 性能：用户类型可提供 ADL 钩子 mllog_format(ML_FormatSink&, const T&) 直接追加到日志缓冲；
+ *        无钩子时的 iostream 回退改为复用线程私有 ostream（直接写入线程私有字符串），不再每个参数构造 ostringstream。
+ *      - 新增：{} 风格宏 MLLOG_INFO_FMT("order {} filled at {:.4f}", id, px) 等（含 _NAMED）。格式串编译期校验：
+ *        标准库支持 std::format 编译期检查时由 std::format_string 校验并走 std::format_to；否则用内置 constexpr 校验
+ *        （括号配对、spec 语法、类型字母/精度/符号与实参类别相容、占位符个数）+ 常用 spec 子集，渲染到栈缓冲。
+ *        两条路径的输出由 tools/mllog_fmt_check.cpp 比对（C++20 与 MLLOG_NO_STD_FORMAT 各构建一次）。
+ *      - 新增：setFileFormat(FileFormat::Binary)：文件只收紧凑二进制记录（int64 纳秒时间戳 + 级别 + 调用点 id + 参数编码，
+ *        调用点与 pattern 每个文件只写一次，.mlb；定长字段固定小端、指针按 8 字节，跨字节序/字长可解），流式日志不再在进程内渲染；ML_Logger::decodeBinaryLog() 与
+ *        tools/mllog_decode.cpp（mllog-decode）用同一 pattern 引擎离线还原文本。ML_ArgCodec 的整数/长度改为 varint。
+ *      - 新增：结构化字段 MLLOG_INFO.kv("user", uid).kv("latency_us", lat) << "request done"：字段按类型编码、
+ *        与正文分开存放，文本输出时以 logfmt（key=value，必要时加引号转义）附在正文后，二进制文件格式保留类型。
+ *      - 新增：setJsonLines(true)：每行输出一个 JSON 对象（ts/level/logger/file/line/msg + kv 字段按类型作为成员，
+ *        与内置成员同名的键加前缀 "kv."），文件可直接被采集管道读取；正文转义按编译目标用 AVX2/SSE2 批量扫描（MLLOG_NO_SIMD 或其他平台走标量）。
+ *        每个对象恰以一个换行结束，正文结尾的 CR/LF 转义在 "msg" 内。
+ *      - 新增：addSink(sink, minLevel, SinkFormat)：内置文件/屏幕之外的附加输出（ML_FileSink/ML_ConsoleSink/
+ *        ML_CallbackSink/ML_MemorySink/ML_SocketSink 或自定义 ML_Logger::Sink），各自有级别下限与行格式；挂有 sink 时
+ *        记录以原始正文交给写出端，同一行格式每条记录只渲染一次、由使用它的 sink 共享。sink 的 write/flush 在
+ *        logger 锁外调用（锁内只取 sink 快照并渲染），自定义 sink 需自行同步。
+ *      - 性能：setScreenAsync(true)：屏幕输出（含 Light 阶段）只追加进有界缓冲，由 ML_AsyncConsole 后台线程每批一次
+ *        writev(2) 直写 fd，不再在调用线程经 std::cout 三次写出；缓冲满时丢弃计数并补一行统计，超过整个缓冲的单行
+ *        等缓冲写完后由调用线程直接写出（不丢弃）。ML_ConsoleSink 可选 async。
+ *      - 性能：setGroupCommit(on, maxBytes, maxDelayUs, fsyncPerBatch)：文件按批提交，字节/时间窗/写线程取空队列时
+ *        整批一次写出、一次 flush（可选一次 fdatasync），取代逐条 auto-flush；ML_FastOFStream 新增 sync()。
+ *      - 性能：ML_FastOFStream 在 POSIX 上也改为原始 fd（open/write）+ 自管 1MB 缓冲，与 Windows 同一实现：写入只 memcpy，
+ *        不再经过 stdio 的 FILE 锁；进程退出时由 Registry 的 atexit 钩子写出各 logger 的缓冲。
+ *      - 性能：setFileMmap(true)（POSIX）：分段按 maxSizeInBytes 预分配并 mmap，写入只 memcpy 进映射，无 write 系统调用；
+ *        崩溃后内容仍在页缓存中。滚动/关闭/退出时截回实际长度；二进制格式的类型字节 0 定义为填充。
+ *        不兼容外部截短（logrotate copytruncate）；可用 setFileMmapSigbusGuard(true) 显式安装 SIGBUS 防护转为 write 续写。
+ *      - 性能：setFileIoUring(true)（Linux，以 MLLOG_IO_URING=1 构建）：ML_FastOFStream 经 io_uring 异步写出，
+ *        三块登记缓冲轮换（WRITE_FIXED），至多两批在途；flush 提交后不等待，完成项在换块/下次 flush 时顺手回收，
+ *        不足 4KB 的小批直接 pwrite（小块提交比 write 更费写线程）。sync() 在写后追加带 IO_DRAIN 的 fdatasync，
+ *        短写重新提交剩余部分。打开时探测 WRITE/FSYNC 操作码，不支持或提交未被内核全部接收时退回 write。
+ *        自检：tools/mllog_uring_check.cpp。
+ *      - 性能：setFilePreallocate(on, writebackBytes)（Linux）：分段打开时 fallocate(FALLOC_FL_KEEP_SIZE) 预留到 maxSizeInBytes，
+ *        可选每 writebackBytes 字节 sync_file_range 异步回写，写延迟不随内核集中刷脏页抖动；关闭分段时释放未用预分配。
+ *      - 性能：setBackgroundRoll(true)：分段写到 3/4 时由后台线程（ML_FileRoller）建目录并预开下一分段，滚动时只交换
+ *        流对象，旧分段在后台写出并关闭；rollFiles_() 不再在持有 _mutex 时 mkdir/open/close。关闭后的旧分段流留作下次预开
+ *        复用（不再每段新分配 1MB 缓冲）；滚动时预开尚未完成则不等待，直接同步打开。后台线程为可 join 的成员，进程退出时
+ *        在各 logger 的退出 flush 之后执行完剩余任务并 join。
  * @version 2.9.2
  *      - 修复Windows下, 在C: D:盘根目录无法创建log文件夹的bug.
  * @version 2.9.1
@@ -248,6 +313,8 @@
 #include <cctype>
 #include <cerrno>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstdarg>
 #include <cstdint>
 #include <cstdio>
@@ -258,6 +325,8 @@
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -265,7 +334,36 @@
 #include <stdexcept>
 #include <string>
 #include <thread> // [NEW] 线程id散列
+#include <type_traits>
+#include <utility>
 #include <vector>
+#if defined(__has_include)
+#if __has_include(<charconv>) && __cplusplus >= 201703L
+#include <charconv> // 有浮点 to_chars 时（__cpp_lib_to_chars）用于最短往返格式化
+#endif
+#if __has_include(<format>) && (__cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L))
+#include <format>
+#endif
+#endif
+/* MLLOG_*_FMT：标准库提供编译期检查的 std::format（P2216）时使用 std::format_to，否则使用内置子集；
+ * 定义 MLLOG_NO_STD_FORMAT 可强制使用内置实现。 */
+#if !defined(MLLOG_NO_STD_FORMAT) && defined(__cpp_lib_format) && __cpp_lib_format >= 202106L
+#define MLLOG_HAS_STD_FORMAT 1
+#else
+#define MLLOG_HAS_STD_FORMAT 0
+#endif
+/* JSON 转义的向量化扫描：按编译目标选用 AVX2（-mavx2）/ SSE2（x86-64 基线），其余平台或定义 MLLOG_NO_SIMD 时走标量 */
+#if !defined(MLLOG_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define MLLOG_SIMD_AVX2 1
+#endif
+#if !defined(MLLOG_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define MLLOG_SIMD_SSE2 1
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 #if defined(_WIN32)
 #ifndef NOMINMAX
@@ -284,8 +382,16 @@
 #else
 #include <dirent.h>
 #include <dlfcn.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #endif
 
@@ -301,11 +407,45 @@
 #define MLLOG_COLOR_RESET "\x1B[0m"
 #define MLLOG_EMPTY ""
 
+/* 编译期最低级别：低于此级别的日志宏在优化构建中整体消除（参数不求值）。
+ * 取值与 ML_Logger::Level 一致：0=Debug ... 6=Alert，7=全部关闭。例如 -DMLLOG_ACTIVE_LEVEL=1 去掉 DEBUG。 */
+#define MLLOG_LEVEL_DEBUG 0
+#define MLLOG_LEVEL_INFO 1
+#define MLLOG_LEVEL_NOTICE 2
+#define MLLOG_LEVEL_WARNING 3
+#define MLLOG_LEVEL_ERROR 4
+#define MLLOG_LEVEL_CRITICAL 5
+#define MLLOG_LEVEL_ALERT 6
+#define MLLOG_LEVEL_OFF 7
+#ifndef MLLOG_ACTIVE_LEVEL
+#define MLLOG_ACTIVE_LEVEL MLLOG_LEVEL_DEBUG
+#endif
+
+/* 主机字节序：二进制编码的定长字段一律按小端存放，大端主机上读写时翻转 */
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define MLLOG_BIG_ENDIAN_ 1
+#else
+#define MLLOG_BIG_ENDIAN_ 0
+#endif
+
 /* 可选强刷到磁盘（默认关） */
 #ifndef MLLOG_DURABLE_FLUSH
 #define MLLOG_DURABLE_FLUSH 0
 #endif
 
+/* 可选 io_uring 文件写出（默认关，仅 Linux；直接走系统调用，不依赖 liburing）。开启后仍需 setFileIoUring(true)，
+ * 内核不支持或被禁用时运行期退回普通 write */
+#ifndef MLLOG_IO_URING
+#define MLLOG_IO_URING 0
+#endif
+#if MLLOG_IO_URING && defined(__linux__)
+#define MLLOG_HAS_IO_URING_ 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#else
+#define MLLOG_HAS_IO_URING_ 0
+#endif
+
 #if defined(_WIN32)
 #ifdef ENABLE_VIRTUAL_TERMINAL_PROCESSING
 #define MLLOG_VT_ENABLE ENABLE_VIRTUAL_TERMINAL_PROCESSING
@@ -379,1826 +519,7301 @@ namespace mllog_v292
 
         template <class T>
         ML_NODISCARD ML_ALWAYS_INLINE constexpr const T& ml_max(const T& a, const T& b) noexcept { return (a < b) ? b : a; }
+        template <class T>
+        ML_NODISCARD ML_ALWAYS_INLINE constexpr const T& ml_min(const T& a, const T& b) noexcept { return (b < a) ? b : a; }
 
-        /* ============= 轻量 ofstream 替代（略同你现有实现） ============= */
-        class ML_FastOFStream
+        /* ============= 数值格式化（LoggerStream 与写线程渲染共用） ============= */
+        /* ============= 栈上小缓冲（超长时才落到堆） ============= */
+        template <size_t N>
+        class ML_SmallBuf
         {
         public:
-            ML_FastOFStream()
-#if defined(_WIN32)
-                : fd_(-1), len_(0), failed_(false), buf_(1 << 20)
-#else
-                : fp_(nullptr), failed_(false)
-#endif
+            ML_SmallBuf() : _p(_inline), _n(0), _cap(N) {}
+            ~ML_SmallBuf()
             {
+                if (_p != _inline)
+                    delete[] _p;
             }
-            ~ML_FastOFStream() { close(); }
+            ML_SmallBuf(const ML_SmallBuf&) = delete;
+            ML_SmallBuf& operator=(const ML_SmallBuf&) = delete;
 
-            ML_FastOFStream(const ML_FastOFStream&) = delete;
-            ML_FastOFStream& operator=(const ML_FastOFStream&) = delete;
+            void append(const char* s, size_t n)
+            {
+                if (_n + n > _cap)
+                    grow_(_n + n);
+                std::memcpy(_p + _n, s, n);
+                _n += n;
+            }
+            void push_back(char c)
+            {
+                if (_n == _cap)
+                    grow_(_n + 1);
+                _p[_n++] = c;
+            }
+            const char* data() const { return _p; }
+            size_t size() const { return _n; }
+            bool empty() const { return _n == 0; }
+            void clear() { _n = 0; }
 
-            void open(const std::string& path, std::ios::openmode mode)
+        private:
+            void grow_(size_t need)
             {
-                close();
-                failed_ = false;
-#if defined(_WIN32)
-                int flags = _O_WRONLY | _O_BINARY | _O_CREAT;
-                if (mode & std::ios::trunc)
-                    flags |= _O_TRUNC;
-                else if (mode & std::ios::app)
-                    flags |= _O_APPEND;
-                int pmode = _S_IREAD | _S_IWRITE;
-                if (_sopen_s(&fd_, path.c_str(), flags, _SH_DENYNO, pmode) != 0)
-                {
-                    fd_ = -1;
-                    failed_ = true;
-                    return;
-                }
-                len_ = 0;
-#else
-                const bool trunc = (mode & std::ios::trunc) != 0;
-                const bool app = (mode & std::ios::app) != 0;
-                const char* m = trunc ? "wb" : (app ? "ab" : "wb");
-                fp_ = ::fopen(path.c_str(), m);
-                if (fp_)
-                    (void)::setvbuf(fp_, nullptr, _IOFBF, 1 << 20);
-                failed_ = (fp_ == nullptr);
-#endif
+                const size_t cap = ml_max(need, _cap * 2);
+                char* np = new char[cap];
+                std::memcpy(np, _p, _n);
+                if (_p != _inline)
+                    delete[] _p;
+                _p = np;
+                _cap = cap;
             }
 
-            bool is_open() const
+            char _inline[N];
+            char* _p;
+            size_t _n;
+            size_t _cap;
+        };
+
+        /* ============= 数字格式化（替代 snprintf） ============= */
+        inline const char* ml_digit_pairs()
+        {
+            static const char t[] =
+                "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                "8081828384858687888990919293949596979899";
+            return t;
+        }
+        // 从 end 向前写入十进制，返回起始位置（调用方保证至少 20 字节空间）
+        inline char* ml_format_u64(char* end, unsigned long long v)
+        {
+            const char* pairs = ml_digit_pairs();
+            while (v >= 100)
             {
-#if defined(_WIN32)
-                return fd_ != -1;
-#else
-                return fp_ != nullptr;
-#endif
+                const unsigned i = (unsigned)(v % 100) * 2;
+                v /= 100;
+                *--end = pairs[i + 1];
+                *--end = pairs[i];
             }
+            if (v < 10)
+                *--end = (char)('0' + v);
+            else
+            {
+                const unsigned i = (unsigned)v * 2;
+                *--end = pairs[i + 1];
+                *--end = pairs[i];
+            }
+            return end;
+        }
+        inline char* ml_format_i64(char* end, long long v)
+        {
+            const unsigned long long u = v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+            char* p = ml_format_u64(end, u);
+            if (v < 0)
+                *--p = '-';
+            return p;
+        }
 
-            void write(const char* data, size_t n)
+        template <class Buf>
+        inline void ml_append_int(Buf& out, long long v)
+        {
+            char tmp[24];
+            const char* p = ml_format_i64(tmp + sizeof(tmp), v);
+            out.append(p, (size_t)(tmp + sizeof(tmp) - p));
+        }
+        template <class Buf>
+        inline void ml_append_uint(Buf& out, unsigned long long v)
+        {
+            char tmp[24];
+            const char* p = ml_format_u64(tmp + sizeof(tmp), v);
+            out.append(p, (size_t)(tmp + sizeof(tmp) - p));
+        }
+
+        // 无 to_chars 时的快速路径：|v| 在 [1e-4, 2^53) 内时按 k = 0..15 取 m = round(|v| * 10^k)，首个满足
+        // (T)(m / 10^k) == v 的即输出 m / 10^k。m 与 10^k 都能精确表示、IEEE 除法正确舍入，与解析该小数的结果一致；
+        // 找不到时返回 0
+        template <class T>
+        inline int ml_format_float_short_(char* buf, size_t cap, T v)
+        {
+            static const double p10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+            const double d = (double)v;
+            const double a = d < 0 ? -d : d;
+            if (!(a >= 1e-4 && a < 9007199254740992.0) || cap < 48)
+                return 0;
+            for (int k = 0; k < 16; ++k)
             {
-                if (n == 0)
-                    return;
-#if defined(_WIN32)
-                if (fd_ == -1)
+                const double sc = a * p10[k];
+                if (sc >= 9007199254740992.0)
+                    return 0;
+                unsigned long long m = (unsigned long long)(sc + 0.5);
+                if ((T)((double)m / p10[k]) != (T)a)
+                    continue;
+                while (k > 0 && m % 10 == 0)
                 {
-                    failed_ = true;
-                    return;
+                    m /= 10;
+                    --k;
                 }
-                if (n < (buf_.size() >> 1))
+                char tmp[24];
+                const char* p = ml_format_u64(tmp + sizeof(tmp), m);
+                const int nd = (int)(tmp + sizeof(tmp) - p);
+                char* o = buf;
+                if (d < 0)
+                    *o++ = '-';
+                if (nd <= k)
                 {
-                    if (len_ + n > buf_.size())
-                        flush_buffer_();
-                    if (n > buf_.size())
-                    {
-                        size_t off = 0;
-                        while (off < n)
-                        {
-                            unsigned chunk = (unsigned)std::min<size_t>(n - off, 1 << 20);
-                            int w = _write(fd_, data + off, chunk);
-                            if (w != (int)chunk)
-                            {
-                                failed_ = true;
-                                break;
-                            }
-                            off += (size_t)w;
-                        }
-                        return;
-                    }
-                    std::memcpy(buf_.data() + len_, data, n);
-                    len_ += n;
+                    *o++ = '0';
+                    *o++ = '.';
+                    for (int z = nd; z < k; ++z)
+                        *o++ = '0';
+                    std::memcpy(o, p, (size_t)nd);
+                    o += nd;
                 }
                 else
                 {
-                    flush_buffer_();
-                    size_t off = 0;
-                    while (off < n)
+                    std::memcpy(o, p, (size_t)(nd - k));
+                    o += nd - k;
+                    if (k > 0)
                     {
-                        unsigned chunk = (unsigned)std::min<size_t>(n - off, 1 << 20);
-                        int w = _write(fd_, data + off, chunk);
-                        if (w != (int)chunk)
-                        {
-                            failed_ = true;
-                            break;
-                        }
-                        off += (size_t)w;
+                        *o++ = '.';
+                        std::memcpy(o, p + nd - k, (size_t)k);
+                        o += k;
                     }
                 }
-#else
-                if (!fp_)
-                {
-                    failed_ = true;
-                    return;
-                }
-                size_t w = ::fwrite(data, 1, n, fp_);
-                if (w != n)
-                    failed_ = true;
-#endif
+                return (int)(o - buf);
             }
+            return 0;
+        }
 
-            void put(char c)
+        // 浮点：prec < 0 为可往返表示；prec >= 0 为有效数字位数（同 %.*g）。
+        // 有 C++17 浮点 to_chars 时取最短往返；否则短小数走 ml_format_float_short_，其余一次 %.*g（max_digits10 位）
+        template <class T>
+        inline int ml_format_float(char* buf, size_t cap, T v, int prec)
+        {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+            const std::to_chars_result r = prec < 0 ? std::to_chars(buf, buf + cap, v)
+                                                    : std::to_chars(buf, buf + cap, v, std::chars_format::general, prec);
+            if (r.ec == std::errc())
+                return (int)(r.ptr - buf);
+#endif
+            if (prec < 0)
             {
+                const int n = ml_format_float_short_(buf, cap, v);
+                if (n > 0)
+                    return n;
+                prec = std::numeric_limits<T>::max_digits10;
+            }
 #if defined(_WIN32)
-                if (fd_ == -1)
-                {
-                    failed_ = true;
-                    return;
-                }
-                if (len_ == buf_.size())
-                    flush_buffer_();
-                buf_[len_] = c;
-                ++len_;
+            return _snprintf(buf, (unsigned)cap, "%.*g", prec, (double)v);
 #else
-                if (!fp_)
-                {
-                    failed_ = true;
-                    return;
-                }
-                if (::fputc((unsigned char)c, fp_) == EOF)
-                    failed_ = true;
+            return std::snprintf(buf, cap, "%.*g", prec, (double)v);
 #endif
-            }
+        }
+        // LoggerStream 的浮点精度操纵符：MLLOG_INFO << ML_NS::ml_precision(3) << 3.14159; 传 -1 恢复默认的往返表示
+        struct ML_Precision
+        {
+            int digits;
+        };
+        inline ML_Precision ml_precision(int digits) { return ML_Precision{digits}; }
 
-            void flush()
+        template <class Buf, class T>
+        inline void ml_append_float(Buf& out, T v, int prec = -1)
+        {
+            char tmp[64];
+            const int n = ml_format_float(tmp, sizeof(tmp), v, prec);
+            if (n > 0)
+                out.append(tmp, (size_t)n < sizeof(tmp) ? (size_t)n : sizeof(tmp) - 1);
+        }
+        template <class Buf>
+        inline void ml_append_ptr(Buf& out, const void* p)
+        {
+            if (!p)
             {
+                out.append("nullptr", 7);
+                return;
+            }
+            char tmp[32];
 #if defined(_WIN32)
-                if (fd_ == -1)
-                    return;
-                flush_buffer_();
-#if MLLOG_DURABLE_FLUSH
-                if (_commit(fd_) != 0)
-                    failed_ = true;
-#endif
+            int n = _snprintf(tmp, (unsigned)sizeof(tmp), "%p", p);
 #else
-                if (!fp_)
-                    return;
-                if (::fflush(fp_) != 0)
-                    failed_ = true;
-#if MLLOG_DURABLE_FLUSH
-                if (::fsync(::fileno(fp_)) != 0)
-                    failed_ = true;
+            int n = std::snprintf(tmp, sizeof(tmp), "%p", p);
 #endif
+            if (n > 0)
+                out.append(tmp, (size_t)n);
+        }
+
+        /* ============= JSON 字符串转义 ============= */
+        inline unsigned ml_ctz32_(unsigned v)
+        {
+#if defined(_MSC_VER)
+            unsigned long i;
+            _BitScanForward(&i, v);
+            return (unsigned)i;
+#else
+            return (unsigned)__builtin_ctz(v);
 #endif
-            }
+        }
 
-            void close()
+        // 返回 [i, n) 中第一个需转义字节（'"'、'\\'、<= 0x1F）的下标，没有则返回 n。
+        // 向量路径一次比较 32/16 字节；字节按无符号比较，UTF-8 多字节序列原样通过
+        inline size_t ml_json_scan_(const char* s, size_t i, size_t n)
+        {
+#if defined(MLLOG_SIMD_AVX2)
             {
-#if defined(_WIN32)
-                if (fd_ != -1)
+                const __m256i q = _mm256_set1_epi8('"');
+                const __m256i bs = _mm256_set1_epi8('\\');
+                const __m256i ctl = _mm256_set1_epi8(0x1F);
+                for (; i + 32 <= n; i += 32)
                 {
-                    flush_buffer_();
-                    _close(fd_);
-                    fd_ = -1;
+                    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+                    const __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, q), _mm256_cmpeq_epi8(v, bs)),
+                                                        _mm256_cmpeq_epi8(_mm256_max_epu8(v, ctl), ctl));
+                    const unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+                    if (mask)
+                        return i + ml_ctz32_(mask);
                 }
-#else
-                if (fp_)
+            }
+#endif
+#if defined(MLLOG_SIMD_SSE2)
+            {
+                const __m128i q = _mm_set1_epi8('"');
+                const __m128i bs = _mm_set1_epi8('\\');
+                const __m128i ctl = _mm_set1_epi8(0x1F);
+                for (; i + 16 <= n; i += 16)
                 {
-                    ::fclose(fp_);
-                    fp_ = nullptr;
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+                    const __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, q), _mm_cmpeq_epi8(v, bs)),
+                                                     _mm_cmpeq_epi8(_mm_max_epu8(v, ctl), ctl));
+                    const unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+                    if (mask)
+                        return i + ml_ctz32_(mask);
                 }
-#endif
             }
-
-            void seekp(long long off, std::ios_base::seekdir dir)
-            {
-#if defined(_WIN32)
-                if (fd_ == -1)
-                    return;
-                flush_buffer_();
-                int whence = (dir == std::ios_base::beg) ? SEEK_SET : (dir == std::ios_base::cur) ? SEEK_CUR
-                                                                                                  : SEEK_END;
-                (void)_lseeki64(fd_, off, whence);
-#else
-                if (!fp_)
-                    return;
-                int whence = (dir == std::ios_base::beg) ? SEEK_SET : (dir == std::ios_base::cur) ? SEEK_CUR
-                                                                                                  : SEEK_END;
-                ::fseeko(fp_, (off_t)off, whence);
 #endif
-            }
-
-            std::streampos tellp()
+            for (; i < n; ++i)
             {
-#if defined(_WIN32)
-                if (fd_ == -1)
-                    return std::streampos(-1);
-                __int64 pos = _telli64(fd_);
-                return (pos >= 0) ? std::streampos(pos) : std::streampos(-1);
-#else
-                if (!fp_)
-                    return std::streampos(-1);
-                off_t pos = ::ftello(fp_);
-                return (pos >= 0) ? std::streampos(pos) : std::streampos(-1);
-#endif
+                const unsigned char c = (unsigned char)s[i];
+                if (c == '"' || c == '\\' || c <= 0x1F)
+                    return i;
             }
+            return n;
+        }
 
-            bool bad() const { return failed_; }
-            void clear_bad() { failed_ = false; }
-#ifndef _WIN32
-            int native_fileno() const { return fp_ ? ::fileno(fp_) : -1; }
-#endif
-        private:
-#if defined(_WIN32)
-            void flush_buffer_()
+        // 追加 JSON 字符串内容（不含两侧引号）：普通字节整段追加，仅对命中的字节逐个转义
+        template <class Buf>
+        inline void ml_json_escape(Buf& out, const char* s, size_t n)
+        {
+            size_t i = 0;
+            while (i < n)
             {
-                size_t off = 0;
-                while (off < len_)
+                const size_t k = ml_json_scan_(s, i, n);
+                out.append(s + i, k - i);
+                if (k == n)
+                    return;
+                const unsigned char c = (unsigned char)s[k];
+                switch (c)
                 {
-                    unsigned chunk = (unsigned)std::min<size_t>(len_ - off, 1 << 20);
-                    int w = _write(fd_, buf_.data() + off, chunk);
-                    if (w != (int)chunk)
-                    {
-                        failed_ = true;
-                        break;
-                    }
-                    off += (size_t)w;
+                case '"':
+                    out.append("\\\"", 2);
+                    break;
+                case '\\':
+                    out.append("\\\\", 2);
+                    break;
+                case '\n':
+                    out.append("\\n", 2);
+                    break;
+                case '\r':
+                    out.append("\\r", 2);
+                    break;
+                case '\t':
+                    out.append("\\t", 2);
+                    break;
+                default:
+                {
+                    const char u[6] = {'\\', 'u', '0', '0', "0123456789abcdef"[c >> 4], "0123456789abcdef"[c & 15]};
+                    out.append(u, 6);
                 }
-                len_ = 0;
+                break;
+                }
+                i = k + 1;
             }
-            int fd_;
-            size_t len_;
-            bool failed_;
-            std::vector<char> buf_;
+        }
+        template <class Buf>
+        inline void ml_json_string(Buf& out, const char* s, size_t n)
+        {
+            out.push_back('"');
+            ml_json_escape(out, s, n);
+            out.push_back('"');
+        }
+
+        /* ============= 定长数值的小端序列化 ============= */
+        // 二进制文件（.mlb）与参数编码共用；小端主机上即逐字节拷贝
+        template <class T>
+        inline void ml_store_le(char* out, const T& v)
+        {
+            std::memcpy(out, &v, sizeof(T));
+#if MLLOG_BIG_ENDIAN_
+            std::reverse(out, out + sizeof(T));
+#endif
+        }
+        template <class T>
+        inline void ml_load_le(T& v, const char* in)
+        {
+#if MLLOG_BIG_ENDIAN_
+            char tmp[sizeof(T)];
+            std::reverse_copy(in, in + sizeof(T), tmp);
+            std::memcpy(&v, tmp, sizeof(T));
 #else
-            FILE* fp_;
-            bool failed_;
+            std::memcpy(&v, in, sizeof(T));
 #endif
-        };
-
-        /* ======================= Registry 前向声明 ======================= */
-        class ML_Logger;
+        }
 
-        class ML_LoggerRegistry
+        /* ============= 延迟格式化：参数的二进制编码 ============= */
+        // 热路径只做 memcpy：每个参数编码为 [tag][字节]，整数/长度为 varint，字符串按值拷贝。
+        // 定长字段为小端、指针按 8 字节存放，与主机字节序/字长无关：由写线程 render() 成文本，或随二进制文件格式
+        // 在任意平台上由解码工具解码。
+        class ML_ArgCodec
         {
         public:
-            static ML_LoggerRegistry& getInstance();
-            ML_Logger& get(const std::string& name);
-            ~ML_LoggerRegistry();
-
-        private:
-            ML_LoggerRegistry() = default;
-            ML_LoggerRegistry(const ML_LoggerRegistry&) = delete;
-            ML_LoggerRegistry& operator=(const ML_LoggerRegistry&) = delete;
+            enum Tag : unsigned char
+            {
+                I64 = 1,
+                U64,
+                F64,
+                Char,
+                Bool,
+                Ptr,
+                Str,
+                F32,
+                Prec // 之后浮点参数的精度（i32，-1 为最短往返）
+            };
 
-            std::mutex _mutex;
-            std::map<std::string, std::unique_ptr<ML_Logger>> _loggers;
-        };
+            // 整数、长度与精度按 varint 存放（有符号值先 zigzag）：常见小数值只占 1~2 字节，异步队列与二进制日志都更紧凑
+            template <class Buf>
+            static void put_i64(Buf& b, long long v) { put_varint_(b, I64, zigzag_(v)); }
+            template <class Buf>
+            static void put_u64(Buf& b, unsigned long long v) { put_varint_(b, U64, v); }
+            template <class Buf>
+            static void put_f64(Buf& b, double v) { put_pod_(b, F64, v); }
+            template <class Buf>
+            static void put_f32(Buf& b, float v) { put_pod_(b, F32, v); }
+            template <class Buf>
+            static void put_prec(Buf& b, int digits) { put_varint_(b, Prec, zigzag_(digits)); }
+            template <class Buf>
+            static void put_char(Buf& b, char c) { put_pod_(b, Char, c); }
+            template <class Buf>
+            static void put_bool(Buf& b, bool v) { put_pod_(b, Bool, (unsigned char)(v ? 1 : 0)); }
+            template <class Buf>
+            static void put_ptr(Buf& b, const void* p) { put_pod_(b, Ptr, (uint64_t)(uintptr_t)p); }
+            template <class Buf>
+            static void put_str(Buf& b, const char* s, size_t n)
+            {
+                put_varint_(b, Str, (uint32_t)n);
+                b.append(s, (uint32_t)n);
+            }
 
-        /* ========================= 核心类 ========================= */
-        class ML_Logger
-        {
-        public:
-            enum class Level
+            // 解码出的单个参数（Str 指向编码缓冲内部）
+            struct Value
             {
-                Debug = 0,
-                Info,
-                Notice,
-                Warning,
-                Error,
-                Critical,
-                Alert
+                Tag tag;
+                union
+                {
+                    long long i;
+                    unsigned long long u;
+                    double d;
+                    float f;
+                    char c;
+                    bool b;
+                    const void* ptr;
+                    int prec;
+                };
+                const char* s;
+                size_t n;
             };
-            using ErrorHandler = std::function<void(const std::string&)>;
 
-            static const size_t MAX_LOG_MESSAGE_SIZE = 1024u * 1024u * 5u;
-            static constexpr const char* TRUNCATED_MESSAGE = "\n... [Message Truncated]";
-            enum class Phase : int
+            // 解码下一个参数；结束或遇到损坏数据时返回 false
+            static bool next(const char*& p, const char* end, Value& v)
             {
-                Off = 0,
-                Light = 1,
-                Full = 2
-            };
-            static ML_Logger& get(const std::string& name = "default")
+                if (p >= end)
+                    return false;
+                v.tag = (Tag)(unsigned char)*p++;
+                unsigned long long x = 0;
+                switch (v.tag)
+                {
+                case I64:
+                    if (!get_varint_(p, end, x))
+                        return false;
+                    v.i = unzigzag_(x);
+                    return true;
+                case U64:
+                    return get_varint_(p, end, v.u);
+                case F64:
+                    return get_pod_(p, end, v.d);
+                case F32:
+                    return get_pod_(p, end, v.f);
+                case Prec:
+                    if (!get_varint_(p, end, x))
+                        return false;
+                    v.prec = (int)unzigzag_(x);
+                    return true;
+                case Char:
+                    return get_pod_(p, end, v.c);
+                case Bool:
+                {
+                    unsigned char c = 0;
+                    if (!get_pod_(p, end, c))
+                        return false;
+                    v.b = c != 0;
+                    return true;
+                }
+                case Ptr:
+                {
+                    uint64_t a = 0;
+                    if (!get_pod_(p, end, a))
+                        return false;
+                    v.ptr = (const void*)(uintptr_t)a;
+                    return true;
+                }
+                case Str:
+                    if (!get_varint_(p, end, x) || (unsigned long long)(end - p) < x)
+                        return false;
+                    v.s = p;
+                    v.n = (size_t)x;
+                    p += x;
+                    return true;
+                default:
+                    return false;
+                }
+            }
+
+            // 解码并按 LoggerStream 的规则渲染为文本；遇到损坏数据即停止
+            static void render(const char* p, size_t n, std::string& out)
             {
-                return ML_LoggerRegistry::getInstance().get(name);
+                const char* end = p + n;
+                int prec = -1;
+                Value v;
+                while (next(p, end, v))
+                {
+                    switch (v.tag)
+                    {
+                    case I64:
+                        ml_append_int(out, v.i);
+                        break;
+                    case U64:
+                        ml_append_uint(out, v.u);
+                        break;
+                    case F64:
+                        ml_append_float(out, v.d, prec);
+                        break;
+                    case F32:
+                        ml_append_float(out, v.f, prec);
+                        break;
+                    case Prec:
+                        prec = v.prec;
+                        break;
+                    case Char:
+                        out.push_back(v.c);
+                        break;
+                    case Bool:
+                        out.push_back(v.b ? '1' : '0');
+                        break;
+                    case Ptr:
+                        ml_append_ptr(out, v.ptr);
+                        break;
+                    case Str:
+                        out.append(v.s, v.n);
+                        break;
+                    }
+                }
             }
-            static ML_Logger& getInstance() { return get("default"); }
-            // [CHG]：带 name 的构造；Registry 会传入
-            ML_Logger(const std::string& name = "default")
-                : _name(name),
-                  _isRoll(false), _logLevel(Level::Debug),
-                  _outputToFile(true), _outputToScreen(true),
-                  _currentRollIndex(0), _maxRolls(5),
-                  _maxSizeInBytes(100u * 1024u * 1024u), _currentSize(0),
-                  _initialized(false), _message_only(false), _add_newline(true),
-                  _log_enabled(false), _log_screen_color(true),
-                  _default_file_name_day(true), _isCheckDay(false),
-                  _start_timestamp(), _last_log_ymd(0), _auto_flush(true),
-                  _need_day_switch(false), _error_handler(nullptr),
-                  _pending_bytes(0), _phase((int)Phase::Off),
-                  _has_pattern(false)
+
+            // 结构化字段（键、值交替编码）按 logfmt 追加为 " key=value ..."；
+            // 字符串值为空或含空白/引号/等号/控制字符时加双引号并转义
+            static void render_fields(const char* p, size_t n, std::string& out)
             {
-                std::string def = get_module_path() + "/log/" + platform_getModuleBasename_() + "_MLLOG";
-                setLogFile(def, _maxRolls, _maxSizeInBytes);
+                const char* end = p + n;
+                Value k, v;
+                while (next(p, end, k) && k.tag == Str && next(p, end, v))
+                {
+                    out.push_back(' ');
+                    out.append(k.s, k.n);
+                    out.push_back('=');
+                    switch (v.tag)
+                    {
+                    case I64:
+                        ml_append_int(out, v.i);
+                        break;
+                    case U64:
+                        ml_append_uint(out, v.u);
+                        break;
+                    case F64:
+                        ml_append_float(out, v.d);
+                        break;
+                    case F32:
+                        ml_append_float(out, v.f);
+                        break;
+                    case Bool:
+                        out.append(v.b ? "true" : "false");
+                        break;
+                    case Ptr:
+                        ml_append_ptr(out, v.ptr);
+                        break;
+                    case Char:
+                        append_logfmt_str_(out, &v.c, 1);
+                        break;
+                    case Str:
+                        append_logfmt_str_(out, v.s, v.n);
+                        break;
+                    case Prec:
+                        break;
+                    }
+                }
             }
 
-            ~ML_Logger()
+            // 结构化字段按 JSON 成员追加为 ,"key":value；整数/浮点/布尔保持类型，非有限浮点、字符与指针写成字符串。
+            // 与内置成员（ts/level/logger/file/line/msg）同名的键加前缀 "kv."，对象内不出现重复键
+            static void render_fields_json(const char* p, size_t n, std::string& out)
             {
-                try
+                const char* end = p + n;
+                Value k, v;
+                while (next(p, end, k) && k.tag == Str && next(p, end, v))
                 {
-                    flush();
+                    out.push_back(',');
+                    out.push_back('"');
+                    if (json_builtin_key_(k.s, k.n))
+                        out.append("kv.", 3);
+                    ml_json_escape(out, k.s, k.n);
+                    out.push_back('"');
+                    out.push_back(':');
+                    switch (v.tag)
+                    {
+                    case I64:
+                        ml_append_int(out, v.i);
+                        break;
+                    case U64:
+                        ml_append_uint(out, v.u);
+                        break;
+                    case F64:
+                    case F32:
+                    {
+                        const double d = v.tag == F64 ? v.d : (double)v.f;
+                        if (!std::isfinite(d))
+                            out.push_back('"');
+                        if (v.tag == F64)
+                            ml_append_float(out, v.d);
+                        else
+                            ml_append_float(out, v.f);
+                        if (!std::isfinite(d))
+                            out.push_back('"');
+                    }
+                    break;
+                    case Bool:
+                        out.append(v.b ? "true" : "false");
+                        break;
+                    case Ptr:
+                        out.push_back('"');
+                        ml_append_ptr(out, v.ptr);
+                        out.push_back('"');
+                        break;
+                    case Char:
+                        ml_json_string(out, &v.c, 1);
+                        break;
+                    case Str:
+                        ml_json_string(out, v.s, v.n);
+                        break;
+                    case Prec:
+                        out.append("null");
+                        break;
+                    }
                 }
-                catch (...)
+            }
+
+        private:
+            static bool json_builtin_key_(const char* s, size_t n)
+            {
+                static const char* const keys[] = {"ts", "level", "logger", "file", "line", "msg"};
+                for (const char* key : keys)
+                    if (std::strlen(key) == n && std::memcmp(key, s, n) == 0)
+                        return true;
+                return false;
+            }
+
+            template <class Buf, class T>
+            static void put_pod_(Buf& b, Tag tag, const T& v)
+            {
+                b.push_back((char)tag);
+                char tmp[sizeof(T)];
+                ml_store_le(tmp, v);
+                b.append(tmp, sizeof(T));
+            }
+            template <class T>
+            static bool get_pod_(const char*& p, const char* end, T& v)
+            {
+                if ((size_t)(end - p) < sizeof(T))
+                    return false;
+                ml_load_le(v, p);
+                p += sizeof(T);
+                return true;
+            }
+            static void append_logfmt_str_(std::string& out, const char* s, size_t n)
+            {
+                bool quote = (n == 0);
+                for (size_t i = 0; i < n && !quote; ++i)
                 {
+                    const unsigned char c = (unsigned char)s[i];
+                    quote = c <= ' ' || c == '"' || c == '=' || c == '\\' || c == 0x7f;
                 }
-                try
+                if (!quote)
                 {
-                    if (_file.is_open())
-                        _file.close();
+                    out.append(s, n);
+                    return;
                 }
-                catch (...)
+                out.push_back('"');
+                for (size_t i = 0; i < n; ++i)
+                {
+                    const char c = s[i];
+                    if (c == '"' || c == '\\')
+                    {
+                        out.push_back('\\');
+                        out.push_back(c);
+                    }
+                    else if (c == '\n')
+                        out.append("\\n", 2);
+                    else if (c == '\r')
+                        out.append("\\r", 2);
+                    else if (c == '\t')
+                        out.append("\\t", 2);
+                    else
+                        out.push_back(c);
+                }
+                out.push_back('"');
+            }
+            static unsigned long long zigzag_(long long v) { return ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63); }
+            static long long unzigzag_(unsigned long long v) { return (long long)(v >> 1) ^ -(long long)(v & 1); }
+            template <class Buf>
+            static void put_varint_(Buf& b, Tag tag, unsigned long long v)
+            {
+                char tmp[11];
+                size_t n = 0;
+                tmp[n++] = (char)tag;
+                while (v >= 0x80)
+                {
+                    tmp[n++] = (char)(v | 0x80);
+                    v >>= 7;
+                }
+                tmp[n++] = (char)v;
+                b.append(tmp, n);
+            }
+            static bool get_varint_(const char*& p, const char* end, unsigned long long& v)
+            {
+                v = 0;
+                for (unsigned shift = 0; p < end && shift < 64; shift += 7)
                 {
+                    const unsigned char c = (unsigned char)*p++;
+                    v |= (unsigned long long)(c & 0x7f) << shift;
+                    if (!(c & 0x80))
+                        return true;
                 }
+                return false;
             }
+        };
 
-            ML_Logger(const ML_Logger&) = delete;
-            ML_Logger& operator=(const ML_Logger&) = delete;
+        /* ============= 轻量 ofstream 替代（略同你现有实现） ============= */
+        // 原始 fd + 自管缓冲（两平台同一实现）：调用方（ML_Logger 的 _mutex 等）已串行化访问，写入只是 memcpy 进缓冲，
+        // 不经过 stdio 的 FILE 锁；缓冲满、flush() 或超长写入时才发起系统调用。
+        // POSIX 可选内存映射（set_mmap）：文件预先扩到段大小并映射，写入直接 memcpy 进映射（无 write 系统调用，
+        // 进程崩溃后内容仍在页缓存中），写满时扩展映射，close 时截回实际长度
+        // Linux 可选 io_uring（MLLOG_IO_URING + set_uring）：写出改为异步提交，多块缓冲轮换、完成项延后回收
+        class ML_FastOFStream
+        {
+        public:
+            static const size_t BUFFER_SIZE = 1u << 20;
 
-            /* 配置接口 */
-            void setLevel(Level lv) { _logLevel = lv; }
-            void setCheckDay(bool on) { _isCheckDay = on; }
-            void setOutput(bool toFile, bool toScreen)
+            ML_FastOFStream() : fd_(-1), len_(0), failed_(false), buf_(BUFFER_SIZE) {}
+            ~ML_FastOFStream() { close(); }
+
+            ML_FastOFStream(const ML_FastOFStream&) = delete;
+            ML_FastOFStream& operator=(const ML_FastOFStream&) = delete;
+
+            // 下次 open 起使用内存映射，segmentBytes 为预分配/映射大小；0 关闭。Windows 或映射失败时退回缓冲写
+            void set_mmap(size_t segmentBytes) { mmap_seg_ = segmentBytes; }
+            // 以追加方式 open 时截去文件尾部的 0 字节（上次以映射写入时崩溃留下的预留区）。开启后以 O_RDWR 打开并回扫尾部，
+            // 只用于映射模式的文本分段；二进制格式的记录可能以 0 结尾，且解码本就跳过零填充，不应开启
+            void set_trim_tail(bool on) { trim_tail_ = on; }
+            // 映射写入的 SIGBUS 防护（默认关）：开启时进程内安装一次 SIGBUS 处理器，映射写入经 sigsetjmp 跳转点，
+            // 文件被外部截短时放弃映射改走 write；未开启时外部截短会让映射写入以 SIGBUS 终止进程
+            void set_sigbus_guard(bool on)
             {
-                _outputToFile = toFile;
-                _outputToScreen = toScreen;
+                sigbus_guard_ = on;
+#if !defined(_WIN32)
+                if (on)
+                    install_sigbus_guard_();
+#endif
+            }
+            // 下次 open 起缓冲经 io_uring 写出（MLLOG_IO_URING 构建）：URING_BUFS 块登记缓冲轮换，flush 把当前块提交后
+            // 立即换一块空闲的继续填，完成事件在换块时顺带收取，只有各块都在途时才等待最早的一块；
+            // sync() 与 close() 等待全部完成。内核不支持时退回 write
+            void set_uring(bool on) { uring_want_ = on; }
+            // 下次 open 起（Linux）按 segmentBytes 以 FALLOC_FL_KEEP_SIZE 预分配分段，追加写不再逐次分配区段；
+            // writebackBytes > 0 时每写出这么多字节发起一次 sync_file_range 异步回写，避免脏页积到阈值后集中刷盘。
+            // 文件系统不支持时忽略；close 时释放末尾未用的预分配
+            void set_prealloc(size_t segmentBytes, size_t writebackBytes)
+            {
+                prealloc_ = segmentBytes;
+                wb_chunk_ = writebackBytes;
+            }
+            bool is_uring() const
+            {
+#if MLLOG_HAS_IO_URING_
+                return ur_.fd >= 0;
+#else
+                return false;
+#endif
+            }
+            // 本次打开以来经 io_uring 提交的写请求数（未启用时为 0）
+            unsigned long long uring_writes() const
+            {
+#if MLLOG_HAS_IO_URING_
+                return ur_.writes;
+#else
+                return 0;
+#endif
+            }
+            bool is_mmapped() const
+            {
+#if defined(_WIN32)
+                return false;
+#else
+                return map_ != nullptr;
+#endif
             }
-            void setAddNewLine(bool add) { _add_newline = add; }
-            bool getAddNewLine() const { return _add_newline; }
-            void setDefaultLogFormat(bool dateOnly) { _default_file_name_day = dateOnly; }
-            void setMessageOnly(bool msgOnly) { _message_only = msgOnly; }
-            void setScreenColor(bool on) { _log_screen_color = on; }
-            void setAutoFlush(bool enabled) { _auto_flush = enabled; }
-            void setErrorHandler(ErrorHandler h) { _error_handler = std::move(h); }
 
-            void setLogSwitch(bool on)
+            // 打开方式相关的设置（mmap / io_uring / 预分配），供后台预开下一分段时照搬
+            struct Options
             {
-                _log_enabled = on;
-                if (on && phase() == Phase::Off)
-                    setPhase_(Phase::Light);
+                size_t mmap_seg;
+                size_t prealloc;
+                size_t wb_chunk;
+                bool uring;
+                bool trim_tail;
+                bool sigbus_guard;
+                bool operator==(const Options& o) const
+                {
+                    return mmap_seg == o.mmap_seg && prealloc == o.prealloc && wb_chunk == o.wb_chunk && uring == o.uring &&
+                           trim_tail == o.trim_tail && sigbus_guard == o.sigbus_guard;
+                }
+            };
+            Options options() const { return Options{mmap_seg_, prealloc_, wb_chunk_, uring_want_, trim_tail_, sigbus_guard_}; }
+            void set_options(const Options& o)
+            {
+                mmap_seg_ = o.mmap_seg;
+                prealloc_ = o.prealloc;
+                wb_chunk_ = o.wb_chunk;
+                uring_want_ = o.uring;
+                trim_tail_ = o.trim_tail;
+                sigbus_guard_ = o.sigbus_guard;
             }
-            bool getLogSwitch() const { return _log_enabled; }
 
-            // ---------- Anywhere-Safe 启停 ----------
-            void startAnywhere(bool emit_banner = true)
+            // 整体交换两个流（fd、缓冲、映射、io_uring 状态与设置）：滚动时换入已预开的分段
+            void swap(ML_FastOFStream& o)
             {
-                std::lock_guard<std::mutex> lk(_mutex);
-                _log_enabled = true;
-                if (phase() == Phase::Off)
-                    setPhase_(Phase::Light);
-                if (emit_banner)
-                    enqueueStartBanner_NoIO_UnsafeLocked_();
+                using std::swap;
+                swap(fd_, o.fd_);
+                swap(len_, o.len_);
+                swap(failed_, o.failed_);
+                buf_.swap(o.buf_);
+#if !defined(_WIN32)
+                swap(map_, o.map_);
+                swap(map_size_, o.map_size_);
+                swap(cur_, o.cur_);
+                swap(synced_, o.synced_);
+#endif
+#if MLLOG_HAS_IO_URING_
+                swap(ur_, o.ur_);
+                for (unsigned i = 0; i < URING_BUFS; ++i)
+                    ustore_[i].swap(o.ustore_[i]);
+#endif
+                swap(uring_want_, o.uring_want_);
+                swap(prealloc_, o.prealloc_);
+                swap(wb_chunk_, o.wb_chunk_);
+                swap(wb_start_, o.wb_start_);
+                swap(wb_dirty_, o.wb_dirty_);
+                swap(prealloced_, o.prealloced_);
+                swap(mmap_seg_, o.mmap_seg_);
+                swap(trim_tail_, o.trim_tail_);
+                swap(sigbus_guard_, o.sigbus_guard_);
             }
 
-            void promoteToFull()
+            void open(const std::string& path, std::ios::openmode mode)
             {
-                struct InLogGuard
+                close();
+                failed_ = false;
+#if defined(_WIN32)
+                int flags = _O_WRONLY | _O_BINARY | _O_CREAT;
+                if (mode & std::ios::trunc)
+                    flags |= _O_TRUNC;
+                else if (mode & std::ios::app)
+                    flags |= _O_APPEND;
+                int pmode = _S_IREAD | _S_IWRITE;
+                if (_sopen_s(&fd_, path.c_str(), flags, _SH_DENYNO, pmode) != 0)
+                    fd_ = -1;
+#else
+                const bool mm = mmap_seg_ > 0;
+#if MLLOG_HAS_IO_URING_
+                const bool ur = !mm && uring_want_;
+#else
+                const bool ur = false;
+#endif
+                const bool append = (mode & std::ios::app) && !(mode & std::ios::trunc);
+                int flags = ((mm || (trim_tail_ && append)) ? O_RDWR : O_WRONLY) | O_CREAT; // 映射/截尾需要可读
+#if defined(O_CLOEXEC)
+                flags |= O_CLOEXEC;
+#endif
+                if (!append)
+                    flags |= O_TRUNC; // 与 fopen("wb") 一致
+                else if (!mm && !ur)
+                    flags |= O_APPEND; // io_uring 的写按偏移、可能乱序完成，不能带 O_APPEND
+                do
+                    fd_ = ::open(path.c_str(), flags, 0644);
+                while (fd_ < 0 && errno == EINTR);
+                if (fd_ >= 0 && trim_tail_ && append)
+                    trim_zero_tail_();
+#if defined(__linux__)
+                if (fd_ >= 0 && (prealloc_ > 0 || wb_chunk_ > 0))
+                    prealloc_open_();
+#endif
+                if (fd_ >= 0 && mm && !map_open_())
+                    (void)::lseek(fd_, 0, SEEK_END); // 退回缓冲写：无 O_APPEND，定位到末尾
+#if MLLOG_HAS_IO_URING_
+                if (fd_ >= 0 && ur)
                 {
-                    InLogGuard() { ML_Logger::in_logging_flag_() = true; }
-                    ~InLogGuard() { ML_Logger::in_logging_flag_() = false; }
-                } guard;
-                std::lock_guard<std::mutex> lk(_mutex);
-                if (phase() == Phase::Full)
-                    return;
+                    uring_open_();
+                    if (ur_.fd < 0)
+                        (void)::lseek(fd_, 0, SEEK_END); // 退回 write：无 O_APPEND，定位到末尾
+                }
+#endif
+#endif
+                failed_ = (fd_ < 0);
+                len_ = 0;
+            }
 
-                if (!_outputToFile)
+            bool is_open() const { return fd_ >= 0; }
+
+            void write(const char* data, size_t n)
+            {
+                if (n == 0)
+                    return;
+                if (fd_ < 0)
                 {
-                    setPhase_(Phase::Full);
-                    _pending_bytes = 0;
-                    _pending.clear();
+                    failed_ = true;
                     return;
                 }
-
-                if (!_initialized)
+#if !defined(_WIN32)
+                if (map_)
                 {
-                    rollFiles_();
-                    _initialized = true;
+                    if (n > map_size_ - cur_ && !map_grow_(n))
+                    {
+                        write_fd_(data, n);
+                        return;
+                    }
+                    if (!map_copy_(data, n))
+                    {
+                        map_fault_();
+                        write_fd_(data, n);
+                        return;
+                    }
+                    cur_ += n;
+                    return;
                 }
-                else if (!_file.is_open())
+#endif
+                if (n <= buf_.size() - len_) // 快路径：放得下就只拷贝
                 {
-                    rollFiles_();
+                    std::memcpy(buf_.data() + len_, data, n);
+                    len_ += n;
+                    return;
                 }
-
-                if (!_file.is_open())
+                flush_buffer_();
+                if (n < (buf_.size() >> 1))
                 {
-                    reportError_("promoteToFull(): open log file failed, stay in Light.");
-                    return;
+                    std::memcpy(buf_.data(), data, n);
+                    len_ = n;
                 }
-
-                for (const auto& line : _pending)
+                else
                 {
-                    const size_t sz = line.size();
-                    if (_currentSize > 0 && (_currentSize + sz > _maxSizeInBytes))
-                        rollFiles_();
-                    _file.write(line.data(), sz);
-                    if (_auto_flush)
-                        _file.flush();
-                    if (_file.bad())
-                    {
-                        reportError_("promoteToFull(): flush pending failed; keeping pending.");
-                        _file.close();
-                        _initialized = false;
-                        return;
-                    }
-                    _currentSize += sz;
-                    if (_currentSize >= _maxSizeInBytes)
-                        rollFiles_();
+                    write_fd_(data, n); // 超长写入不经缓冲
                 }
-                _pending_bytes = 0;
-                _pending.clear();
-                setPhase_(Phase::Full);
             }
 
-            void setLogFile(const std::string& baseName, int maxRolls = 5, size_t maxSizeInBytes = 100u * 1024u * 1024u)
+            void put(char c)
             {
-                std::lock_guard<std::mutex> lk(_mutex);
-                _baseName = baseName;
-                _maxRolls = ml_max(1, maxRolls);
-                _maxSizeInBytes = maxSizeInBytes;
-
-                _currentSize = 0;
-                _currentRollIndex = 0;
-                _initialized = false;
-                _isRoll = false;
-
-                size_t p = _baseName.find_last_of("\\/");
-                _baseNameWithoutPath = (p != std::string::npos) ? _baseName.substr(p + 1) : _baseName;
-
-                _start_timestamp = currentTimestamp_();
-                _baseFullNameWithDateAndTime = _baseName + "_" + _start_timestamp;
-                if (_file.is_open())
-                    _file.close();
-                _curFilePath.clear();
-                _heal_counter = 0;
+#if !defined(_WIN32)
+                if (map_) // 经 write（含可选的 SIGBUS 防护）
+                {
+                    write(&c, 1);
+                    return;
+                }
+#endif
+                if (len_ < buf_.size() && fd_ >= 0)
+                {
+                    buf_[len_++] = c;
+                    return;
+                }
+                write(&c, 1);
             }
 
             void flush()
             {
-                std::lock_guard<std::mutex> lk(_mutex);
-                if (_file.is_open())
-                    _file.flush();
+                if (fd_ < 0)
+                    return;
+                flush_buffer_();
+#if MLLOG_HAS_IO_URING_
+                if (ur_.fd >= 0)
+                    uring_reap_(false); // 只收取已完成的，不等待在途的写
+#endif
+#if MLLOG_DURABLE_FLUSH
+#if MLLOG_HAS_IO_URING_
+                uring_wait_(); // 落盘须覆盖在途的写
+#endif
+                sync_fd_();
+#endif
             }
 
-            // [CHG]：log / logformat 现在额外携带 fullpath 与 func；pattern 可用 %g / %!
-            void log(const char* file_short, const char* file_full, const char* func, int line,
-                     Level lv, const std::string& original, bool isNewLine = true)
+            // flush 并把数据落到存储（组提交每批一次）；MLLOG_DURABLE_FLUSH 时 flush 已含此步
+            void sync()
             {
-                if (!_log_enabled || lv < _logLevel)
+#if MLLOG_HAS_IO_URING_
+                if (ur_.fd >= 0)
+                {
+                    uring_submit_(true);
+                    const unsigned long long reissued = ur_.reissued;
+                    uring_wait_();
+                    if (ur_.reissued != reissued && ur_.fd >= 0) // fdatasync 之后才补写的短写余量
+                        sync_fd_();
                     return;
+                }
+#endif
+                flush();
+#if !MLLOG_DURABLE_FLUSH
+                if (fd_ >= 0)
+                    sync_fd_();
+#endif
+            }
 
-                int ms_count = 0;
-                std::tm cached_tm{};
-                const char* time_c = nullptr;
-                updateAndGetTimeCache_(cached_tm, ms_count, time_c);
-
-                const std::string msg = maybeTruncate_(original);
-                // 计算有效结尾（零分配）
-                size_t end = msg.size();
-                while (end > 0)
+            void close()
+            {
+                if (fd_ < 0)
+                    return;
+                flush_buffer_();
+#if MLLOG_HAS_IO_URING_
+                uring_close_();
+#endif
+#if defined(_WIN32)
+                _close(fd_);
+#else
+                if (map_)
                 {
-                    char c = msg[end - 1];
-                    if (c == '\n' || c == '\r')
-                        --end;
-                    else
-                        break;
+                    ::munmap(map_, map_size_);
+                    map_ = nullptr;
+                    if (::ftruncate(fd_, (off_t)cur_) != 0) // 截去预分配的零尾
+                        failed_ = true;
                 }
-                bool needNewLine = isNewLine && (end == msg.size()); // 仅当原文末尾本就没有换行时才补
-                // -------------------------------------------------------------------
-                // Light 阶段：上屏 + 入 pending
-                if (phase() != Phase::Full)
+#if defined(__linux__)
+                else if (prealloced_)
                 {
-                    std::string linebuf;
-                    if (!_message_only)
-                    {
-                        if (_has_pattern.load(std::memory_order_acquire))
-                        {
-                            std::lock_guard<std::mutex> lk(_mutex); // 复用已有互斥量
-                            if (_has_pattern.load(std::memory_order_relaxed) && !_pat_ops.empty())
-                            {
-                                renderPattern_(cached_tm, ms_count, lv, file_short, file_full, func, line, msg, linebuf);
-                            }
-                            else
-                            {
-                                char prefix[192];
-                                int plen = buildPrefix_(prefix, sizeof(prefix), lv, file_short, line, time_c, ms_count);
-                                if (plen > 0)
-                                    linebuf.append(prefix, (size_t)plen);
-                                linebuf.append(msg.data(), end);
-                            }
-                        }
-                        else
-                        {
-                            char prefix[192];
-                            int plen = buildPrefix_(prefix, sizeof(prefix), lv, file_short, line, time_c, ms_count);
-                            if (plen > 0)
-                                linebuf.append(prefix, (size_t)plen);
-                            linebuf.append(msg.data(), end);
-                        }
-                    }
-                    else
-                    {
-                        linebuf.append(msg.data(), end);
-                    }
-                    if (needNewLine)
-                        linebuf.push_back('\n');
-
-                    {
-                        std::lock_guard<std::mutex> lk(_mutex);
-                        if (_outputToScreen)
-                        {
-                            const bool colorize = _log_screen_color && supportsAnsiColor_();
-                            std::lock_guard<std::mutex> cg(console_mutex_());
-                            if (colorize)
-                                std::cout << levelColorAnsi_(lv);
-                            std::cout.write(linebuf.data(), (std::streamsize)linebuf.size());
-                            if (colorize)
-                                std::cout << MLLOG_COLOR_RESET;
-                        }
-                        enqueuePendingLine_NoIO_UnsafeLocked_(std::move(linebuf));
-                    }
+                    struct stat st{};
+                    if (::fstat(fd_, &st) == 0)
+                        (void)::ftruncate(fd_, st.st_size); // 长度不变，只释放 KEEP_SIZE 预分配的未用区段
+                }
+                prealloced_ = false;
+#endif
+                ::close(fd_);
+#endif
+                fd_ = -1;
+            }
 
-                    tryAutoPromoteToFull_NoThrow_();
+            void seekp(long long off, std::ios_base::seekdir dir)
+            {
+                if (fd_ < 0 || is_mmapped() || is_uring()) // 映射/io_uring 模式只追加，位置恒为末尾
                     return;
-                }
+                flush_buffer_();
+                int whence = (dir == std::ios_base::beg) ? SEEK_SET : (dir == std::ios_base::cur) ? SEEK_CUR
+                                                                                                  : SEEK_END;
+#if defined(_WIN32)
+                (void)_lseeki64(fd_, off, whence);
+#else
+                (void)::lseek(fd_, (off_t)off, whence);
+#endif
+            }
 
-                // Full 阶段
-                auto& formatted = tls_buf_();
-                if (_message_only)
-                {
-                    formatted.assign(msg);
-                }
-                else if (_has_pattern.load(std::memory_order_acquire))
+            std::streampos tellp()
+            {
+                if (fd_ < 0)
+                    return std::streampos(-1);
+#if !defined(_WIN32)
+                if (map_)
+                    return std::streampos((long long)cur_);
+#endif
+#if MLLOG_HAS_IO_URING_
+                if (ur_.fd >= 0)
+                    return std::streampos((long long)(ur_.off + len_));
+#endif
+#if defined(_WIN32)
+                __int64 pos = _telli64(fd_);
+#else
+                off_t pos = ::lseek(fd_, 0, SEEK_CUR);
+#endif
+                return (pos >= 0) ? std::streampos((long long)pos + (long long)len_) : std::streampos(-1);
+            }
+
+            bool bad() const { return failed_; }
+            void clear_bad() { failed_ = false; }
+#ifndef _WIN32
+            int native_fileno() const { return fd_; }
+#endif
+        private:
+            void sync_fd_()
+            {
+#if defined(_WIN32)
+                if (_commit(fd_) != 0)
+                    failed_ = true;
+#else
+                if (map_)
+                    map_sync_();
+#if defined(__linux__)
+                else if (::fdatasync(fd_) != 0)
+                    failed_ = true;
+#else
+                else if (::fsync(fd_) != 0)
+                    failed_ = true;
+#endif
+#endif
+            }
+
+            void flush_buffer_()
+            {
+                if (len_ == 0)
+                    return;
+#if MLLOG_HAS_IO_URING_
+                if (ur_.fd >= 0)
                 {
-                    std::lock_guard<std::mutex> lk(_mutex); // 防止与 setPattern() 并发
-                    if (_has_pattern.load(std::memory_order_relaxed) && !_pat_ops.empty())
+                    // 不足一页的小批（逐条 auto-flush）提交开销高于直接拷进页缓存：同步 pwrite 到在途批次之后，
+                    // 偏移互不重叠，不等待在途的写
+                    if (len_ < URING_MIN_BATCH)
                     {
-                        renderPattern_(cached_tm, ms_count, lv, file_short, file_full, func, line, msg, formatted);
+                        pwrite_all_(buf_.data(), len_, ur_.off);
+                        ur_.off += len_;
+                        writeback_tick_(len_);
+                        len_ = 0;
                     }
                     else
-                    {
-                        formatMessageFast_DefaultPrefix_(lv, file_short, line, time_c, ms_count, msg, formatted);
-                    }
-                }
-                else
-                {
-                    formatMessageFast_DefaultPrefix_(lv, file_short, line, time_c, ms_count, msg, formatted);
+                        uring_submit_(false);
+                    return;
                 }
-                writeToTargets_(formatted, needNewLine, lv);
+#endif
+                write_fd_(buf_.data(), len_);
+                len_ = 0;
             }
 
-            void logformat(const char* file_short, const char* file_full, const char* func, int line,
-                           Level lv, const char* fmt, ...)
+            // 写满 n 字节（处理部分写与 EINTR）；失败置 bad
+            void write_fd_(const char* p, size_t n)
             {
-                if (!_log_enabled || lv < _logLevel)
+#if MLLOG_HAS_IO_URING_
+                if (ur_.fd >= 0)
+                {
+                    pwrite_all_(p, n, ur_.off); // 偏移在在途批次之后，互不重叠，无需等待
+                    ur_.off += n;
+                    writeback_tick_(n);
                     return;
-                std::string s;
-                va_list args;
-                va_start(args, fmt);
-                std::vector<char> buf(256);
-                while (true)
+                }
+#endif
+                const size_t total = n;
+                while (n > 0)
                 {
-                    va_list cpy;
-                    va_copy(cpy, args);
 #if defined(_WIN32)
-                    int need = _vsnprintf(buf.data(), buf.size(), fmt, cpy);
+                    const unsigned chunk = (unsigned)(n < (1u << 20) ? n : (1u << 20));
+                    const int w = _write(fd_, p, chunk);
 #else
-                    int need = vsnprintf(buf.data(), buf.size(), fmt, cpy);
-#endif
-                    va_end(cpy);
-                    if (need < 0)
-                    {
-                        buf.resize(buf.size() * 2);
+                    const ssize_t w = ::write(fd_, p, n);
+                    if (w < 0 && errno == EINTR)
                         continue;
-                    }
-                    if ((size_t)need >= buf.size())
+#endif
+                    if (w <= 0)
                     {
-                        buf.resize((size_t)need + 1);
-                        continue;
+                        failed_ = true;
+                        return;
                     }
-                    s.assign(buf.data(), (size_t)need);
-                    break;
+                    p += w;
+                    n -= (size_t)w;
                 }
-                va_end(args);
-                log(file_short, file_full, func, line, lv, s, _add_newline);
+                writeback_tick_(total);
             }
 
-            // 工具：路径/进程名
-            static std::string get_module_path() { return platform_getModulePath_(); }
-            static std::string get_module_basename() { return platform_getModuleBasename_(); }
-            static std::string process_name() { return platform_getProcessName_(); }
-            ML_DEPRECATED("Use ML_Logger::process_name() (static) instead")
-            std::string get_process_name() const { return ML_Logger::process_name(); }
-
-            // 清理旧日志
-            void cleanupOldLogs(int daysToKeep = 5)
+            // 已写入 n 字节：累计满 wb_chunk_ 时对这一段发起异步回写（只启动，不等待完成）
+            void writeback_tick_(size_t n)
             {
-                std::lock_guard<std::mutex> lk(_mutex);
-                if (!_outputToFile)
+#if defined(__linux__)
+                if (wb_chunk_ == 0)
                     return;
-
-                size_t p = _baseName.find_last_of("\\/");
-                std::string dir = (p != std::string::npos) ? _baseName.substr(0, p + 1) : platform_currentDirWithSlash_();
-                std::string stem = (p != std::string::npos) ? _baseName.substr(p + 1) : _baseName;
-
-                std::vector<std::string> files = platform_listLogFiles_(dir, stem);
-                for (const auto& name : files)
-                    if (shouldDeleteLog_(name, daysToKeep))
-                        platform_deleteFile_(dir + name);
+                wb_dirty_ += n;
+                if (wb_dirty_ < wb_chunk_)
+                    return;
+                (void)::sync_file_range(fd_, (off64_t)wb_start_, (off64_t)wb_dirty_, SYNC_FILE_RANGE_WRITE);
+                wb_start_ += wb_dirty_;
+                wb_dirty_ = 0;
+#else
+                (void)n;
+#endif
             }
 
-            // --------- Pattern API（新增）---------
-            void setPattern(const std::string& pattern)
+#if defined(__linux__)
+            // 从当前末尾起预分配到段大小（不改文件长度），并把回写起点对齐到末尾
+            void prealloc_open_()
             {
-                std::lock_guard<std::mutex> lk(_mutex);
-                _pattern_raw = pattern;
-                _pat_ops.clear();
-                _has_pattern.store(compilePattern_(pattern, _pat_ops), std::memory_order_release);
-            }
-            std::string getPattern()
-            {
-                std::lock_guard<std::mutex> lk(_mutex);
-                return _pattern_raw;
+                struct stat st{};
+                if (::fstat(fd_, &st) != 0)
+                    return;
+                const unsigned long long used = (unsigned long long)st.st_size;
+                wb_start_ = used;
+                wb_dirty_ = 0;
+                if (prealloc_ > used)
+                    prealloced_ = ::fallocate(fd_, FALLOC_FL_KEEP_SIZE, (off_t)used, (off_t)(prealloc_ - used)) == 0;
             }
-            std::string name() const { return _name; }
+#endif
 
-            void setHealCheckEvery(int n)
+#if !defined(_WIN32)
+            static size_t page_round_(size_t n)
             {
-                std::lock_guard<std::mutex> lk(_mutex);
-                _heal_every = (n > 0 ? n : 0);
-                _heal_counter = 0;
+                static const size_t pg = (size_t)::sysconf(_SC_PAGESIZE);
+                return (n + pg - 1) / pg * pg;
             }
 
-        private:
-            /* -------- 运行时状态 & 内部函数（保留原有结构，略去未改动的注释） -------- */
-            enum class Phase_AtomicTag
+            // 把文件扩到 to 字节。Linux 上用 posix_fallocate 占住真实块：磁盘满在此返回失败（退回 write 得到 ENOSPC），
+            // 而不是日后在映射写入时触发 SIGBUS；其它平台只能 ftruncate（稀疏预留）
+            bool map_reserve_(size_t from, size_t to)
             {
-            };
-            Phase phase() const { return (Phase)_phase.load(std::memory_order_acquire); }
-            void setPhase_(Phase p) { _phase.store((int)p, std::memory_order_release); }
+#if defined(__linux__)
+                return ::posix_fallocate(fd_, (off_t)from, (off_t)(to - from)) == 0;
+#else
+                (void)from;
+                return ::ftruncate(fd_, (off_t)to) == 0;
+#endif
+            }
 
-            void enqueuePendingLine_NoIO_UnsafeLocked_(std::string&& line)
+            // 映射当前文件：已有内容之后预留到段大小。失败时恢复原长度并返回 false
+            bool map_open_()
             {
-                _pending_bytes += line.size();
-                _pending.emplace_back(std::move(line));
-                while (_pending_bytes > PENDING_MAX_BYTES || _pending.size() > PENDING_MAX_COUNT)
+                struct stat st{};
+                if (::fstat(fd_, &st) != 0)
+                    return false;
+                const size_t used = (size_t)st.st_size;
+                const size_t want = page_round_(ml_max(mmap_seg_, used + (64u << 10)));
+                if (!map_reserve_(used, want))
                 {
-                    _pending_bytes -= _pending.front().size();
-                    _pending.pop_front();
+                    (void)::ftruncate(fd_, (off_t)used);
+                    return false;
                 }
+                void* p = ::mmap(nullptr, want, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+                if (p == MAP_FAILED)
+                {
+                    (void)::ftruncate(fd_, (off_t)used);
+                    return false;
+                }
+                map_ = static_cast<char*>(p);
+                map_size_ = want;
+                cur_ = used;
+                synced_ = used;
+                return true;
             }
 
-            void enqueueStartBanner_NoIO_UnsafeLocked_()
+            // 记录超出剩余空间（滚动前的最后几条、超长消息）：至少翻倍地扩展文件并重新映射；
+            // 无法再映射时截回实际长度，此后走 fd 写
+            bool map_grow_(size_t n)
             {
-                int ms = 0;
-                std::tm tm{};
-                const char* tc = nullptr;
-                updateAndGetTimeCache_(tm, ms, tc);
-                std::string line;
-
-                if (_has_pattern)
+                const size_t want = page_round_(ml_max(map_size_ * 2, cur_ + n));
+                ::munmap(map_, map_size_);
+                map_ = nullptr;
+                if (map_reserve_(map_size_, want))
                 {
-                    renderPattern_(tm, ms, Level::Alert, "mllog.hpp", "mllog.hpp", "?", 0, "---------- Start MLLOG ----------", line);
+                    void* p = ::mmap(nullptr, want, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+                    if (p != MAP_FAILED)
+                    {
+                        map_ = static_cast<char*>(p);
+                        map_size_ = want;
+                        return true;
+                    }
                 }
-                else
+                (void)::ftruncate(fd_, (off_t)cur_);
+                (void)::lseek(fd_, (off_t)cur_, SEEK_SET);
+                return false;
+            }
+
+            // 写入映射。文件被外部截短（logrotate copytruncate）或稀疏预留遇到磁盘满时，访问映射会触发 SIGBUS：
+            // 开启防护时由本线程的跳转点接住并返回 false（其余 SIGBUS 交给原处理器）
+            bool map_copy_(const char* data, size_t n)
+            {
+                if (!sigbus_guard_)
                 {
-                    char prefix[192];
-                    int plen = buildPrefix_(prefix, sizeof(prefix), Level::Alert, "mllog.hpp", 0, tc, ms);
-                    if (plen > 0)
-                        line.append(prefix, (size_t)plen);
-                    line.append("---------- Start MLLOG ----------");
+                    std::memcpy(map_ + cur_, data, n);
+                    return true;
                 }
-                if (_add_newline)
-                    line.push_back('\n');
-                enqueuePendingLine_NoIO_UnsafeLocked_(std::move(line));
+                sigjmp_buf jb;
+                if (sigsetjmp(jb, 0) != 0)
+                    return false; // 处理器已清除跳转点
+                map_jmp_() = &jb;
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+                std::memcpy(map_ + cur_, data, n);
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+                map_jmp_() = nullptr;
+                return true;
             }
 
-            void tryAutoPromoteToFull_NoThrow_()
+            // 映射写入失败：放弃映射，此后走 fd 写。文件未被截短时截去预留尾部并定位到实际末尾；
+            // 被外部截短时定位到新的末尾（与非映射模式下 copytruncate 后继续追加一致）
+            void map_fault_()
             {
-                if (phase() != Phase::Light)
-                    return;
-                std::lock_guard<std::mutex> lk(_mutex);
-                if (phase() != Phase::Light)
-                    return;
+                ::munmap(map_, map_size_);
+                map_ = nullptr;
+                struct stat st{};
+                if (::fstat(fd_, &st) == 0 && (size_t)st.st_size >= cur_)
+                    (void)::ftruncate(fd_, (off_t)cur_);
+                (void)::lseek(fd_, 0, SEEK_END);
+            }
 
-                if (!_outputToFile)
+            // 跳转点按线程存放。处理器只在 map_copy_ 已写过本变量的线程上读取它（TLS 块已分配，不会在信号中分配内存）
+            static sigjmp_buf*& map_jmp_()
+            {
+                static thread_local sigjmp_buf* jb = nullptr;
+                return jb;
+            }
+            static struct sigaction& old_sigbus_()
+            {
+                static struct sigaction old;
+                return old;
+            }
+
+            static void on_sigbus_(int sig, siginfo_t* si, void* uc)
+            {
+                sigjmp_buf* jb = map_jmp_();
+                if (jb)
                 {
-                    setPhase_(Phase::Full);
-                    _pending_bytes = 0;
-                    _pending.clear();
-                    return;
+                    map_jmp_() = nullptr;
+                    siglongjmp(*jb, 1);
                 }
-                if (!_initialized || !_file.is_open())
+                const struct sigaction& old = old_sigbus_();
+                if (old.sa_flags & SA_SIGINFO)
                 {
-                    rollFiles_();
-                    _initialized = true;
+                    if (old.sa_sigaction)
+                    {
+                        old.sa_sigaction(sig, si, uc);
+                        return;
+                    }
                 }
-                if (!_file.is_open())
+                else if (old.sa_handler != SIG_DFL && old.sa_handler != SIG_IGN)
+                {
+                    old.sa_handler(sig);
                     return;
+                }
+                ::signal(sig, SIG_DFL); // 返回后出错指令重新执行，按默认方式终止
+            }
 
-                for (const auto& line : _pending)
+            // 进程内安装一次 SIGBUS 处理器（SA_NODEFER：siglongjmp 跳出后信号不会保持屏蔽），只在显式开启防护时调用。
+            // 应用此后自行安装的 SIGBUS 处理器会取代它（防护随之失效）；先装的处理器由它转交
+            static void install_sigbus_guard_()
+            {
+                static std::once_flag once;
+                std::call_once(once, []
+                               {
+                    struct sigaction sa;
+                    std::memset(&sa, 0, sizeof(sa));
+                    sa.sa_sigaction = &ML_FastOFStream::on_sigbus_;
+                    sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+                    sigemptyset(&sa.sa_mask);
+                    (void)::sigaction(SIGBUS, &sa, &old_sigbus_()); });
+            }
+
+            // 去掉尾部连续的 0 字节（从后往前按块读），保留最后一个非零字节
+            void trim_zero_tail_()
+            {
+                struct stat st{};
+                if (::fstat(fd_, &st) != 0 || st.st_size <= 0)
+                    return;
+                const off_t end = st.st_size;
+                off_t pos = end;
+                char b[4096];
+                while (pos > 0)
                 {
-                    const size_t sz = line.size();
-                    if (_currentSize > 0 && (_currentSize + sz > _maxSizeInBytes))
-                        rollFiles_();
-                    _file.write(line.data(), sz);
-                    if (_auto_flush)
-                        _file.flush();
-                    if (_file.bad())
-                    {
-                        _file.close();
-                        _initialized = false;
+                    const size_t n = (size_t)ml_min<off_t>(pos, (off_t)sizeof(b));
+                    if (::pread(fd_, b, n, pos - (off_t)n) != (ssize_t)n)
                         return;
-                    }
-                    _currentSize += sz;
-                    if (_currentSize >= _maxSizeInBytes)
-                        rollFiles_();
+                    size_t i = n;
+                    while (i > 0 && b[i - 1] == 0)
+                        --i;
+                    pos -= (off_t)(n - i);
+                    if (i > 0)
+                        break;
                 }
-                _pending_bytes = 0;
-                _pending.clear();
-                setPhase_(Phase::Full);
+                if (pos < end)
+                    (void)::ftruncate(fd_, pos);
             }
 
-            void updateAndGetTimeCache_(std::tm& out_tm, int& out_ms, const char*& out_time_c)
+            // 把上次同步之后写入的页刷到存储
+            void map_sync_()
             {
-                using clock = std::chrono::system_clock;
-                auto now = clock::now();
-                auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % std::chrono::seconds(1);
-                out_ms = (int)ms.count();
-                const std::time_t t = clock::to_time_t(now);
-                struct TLS
+                const size_t from = synced_ - synced_ % page_round_(1);
+                if (cur_ > from && ::msync(map_ + from, cur_ - from, MS_SYNC) != 0)
+                    failed_ = true;
+                synced_ = cur_;
+            }
+
+            char* map_ = nullptr;
+            size_t map_size_ = 0;
+            size_t cur_ = 0;    // 映射内的写入位置（= 文件实际长度）
+            size_t synced_ = 0; // 已 msync 到的位置
+#endif
+#if MLLOG_HAS_IO_URING_
+            static const unsigned URING_BUFS = 3;                   // 登记缓冲块数：一块在填，至多两块在途
+            static const size_t URING_MIN_BATCH = 4096;             // 小于此的批直接 pwrite
+            static const unsigned long long URING_TAG_FSYNC = 0x100; // SQE user_data：写请求为缓冲块序号
+
+            struct Uring_
+            {
+                int fd = -1;
+                void* sq_ptr = nullptr;
+                size_t sq_sz = 0;
+                void* cq_ptr = nullptr;
+                size_t cq_sz = 0;
+                io_uring_sqe* sqes = nullptr;
+                size_t sqes_sz = 0;
+                unsigned* sq_tail = nullptr;
+                unsigned* sq_mask = nullptr;
+                unsigned* sq_array = nullptr;
+                unsigned* cq_head = nullptr;
+                unsigned* cq_tail = nullptr;
+                unsigned* cq_mask = nullptr;
+                io_uring_cqe* cqes = nullptr;
+                bool fixed = false;    // 各块缓冲已登记（WRITE_FIXED）
+                unsigned cur = 0;      // buf_ 当前对应的缓冲块序号
+                unsigned inflight = 0; // 在途 CQE 数
+                struct Io              // 各块在途写的剩余部分（短写时从这里补写）
                 {
-                    std::time_t sec;
-                    std::tm tm;
-                    char time_buf[32];
-                    TLS() : sec((time_t)-1), tm{} { time_buf[0] = '\0'; }
-                };
-                thread_local TLS tls;
-                if (t != tls.sec)
+                    const char* ptr = nullptr;
+                    size_t len = 0;
+                    unsigned long long off = 0;
+                    bool busy = false;
+                } io[URING_BUFS];
+                bool need_sync = false;          // fdatasync 未被内核接收：在途请求完成后同步补做
+                unsigned long long reissued = 0; // 短写补交次数
+                unsigned long long writes = 0;   // 已提交的写请求数
+                unsigned long long off = 0;      // 下一次写入的文件偏移
+                char* bufs[URING_BUFS] = {};
+            };
+
+            void uring_open_()
+            {
+                io_uring_params p{};
+                const int rfd = (int)::syscall(__NR_io_uring_setup, 8, &p);
+                if (rfd < 0)
+                    return;
+                // 探测操作码：WRITE 与 FSYNC 缺一不可（WRITE 与 probe 均自 5.6 起），否则保持普通 write；
+                // WRITE_FIXED 不支持时不登记缓冲
+                std::vector<io_uring_probe_op> pb(2 + IORING_OP_LAST); // 头部 16 字节 + 每个操作码一项
+                io_uring_probe* pr = reinterpret_cast<io_uring_probe*>(pb.data());
+                if (::syscall(__NR_io_uring_register, rfd, IORING_REGISTER_PROBE, pr, (unsigned)IORING_OP_LAST) != 0 ||
+                    !uring_op_ok_(pr, IORING_OP_WRITE) || !uring_op_ok_(pr, IORING_OP_FSYNC))
                 {
-                    tls.sec = t;
-#if defined(_WIN32)
-                    localtime_s(&tls.tm, &t);
-#else
-                    localtime_r(&t, &tls.tm);
-#endif
-                    std::strftime(tls.time_buf, sizeof(tls.time_buf), "%Y-%m-%d %H:%M:%S", &tls.tm);
-                    if (_isCheckDay)
-                    {
-                        const int ymd = (tls.tm.tm_year + 1900) * 10000 + (tls.tm.tm_mon + 1) * 100 + tls.tm.tm_mday;
-                        int last = _last_log_ymd.load(std::memory_order_relaxed);
-                        if (last == 0)
-                            _last_log_ymd.store(ymd, std::memory_order_relaxed);
-                        else if (last != ymd)
-                        {
-                            _need_day_switch.store(true, std::memory_order_relaxed);
-                            _last_log_ymd.store(ymd, std::memory_order_relaxed);
-                        }
-                    }
+                    ::close(rfd);
+                    return;
                 }
-                out_tm = tls.tm;
-                out_time_c = tls.time_buf;
+                Uring_ u;
+                u.fd = rfd;
+                u.sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+                u.cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+                const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                if (single)
+                    u.sq_sz = u.cq_sz = ml_max(u.sq_sz, u.cq_sz);
+                u.sq_ptr = ::mmap(nullptr, u.sq_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, rfd, IORING_OFF_SQ_RING);
+                u.cq_ptr = single ? u.sq_ptr
+                                  : ::mmap(nullptr, u.cq_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, rfd, IORING_OFF_CQ_RING);
+                u.sqes_sz = p.sq_entries * sizeof(io_uring_sqe);
+                void* sqes = ::mmap(nullptr, u.sqes_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, rfd, IORING_OFF_SQES);
+                if (u.sq_ptr == MAP_FAILED || u.cq_ptr == MAP_FAILED || sqes == MAP_FAILED)
+                {
+                    if (u.sq_ptr != MAP_FAILED)
+                        ::munmap(u.sq_ptr, u.sq_sz);
+                    if (!single && u.cq_ptr != MAP_FAILED)
+                        ::munmap(u.cq_ptr, u.cq_sz);
+                    if (sqes != MAP_FAILED)
+                        ::munmap(sqes, u.sqes_sz);
+                    ::close(rfd);
+                    return;
+                }
+                char* sq = static_cast<char*>(u.sq_ptr);
+                char* cq = static_cast<char*>(u.cq_ptr);
+                u.sqes = static_cast<io_uring_sqe*>(sqes);
+                u.sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+                u.sq_mask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+                u.sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+                u.cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+                u.cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+                u.cq_mask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+                u.cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+                // 其余各块缓冲（上次打开留下的直接复用）；一起登记为固定缓冲（受 RLIMIT_MEMLOCK 限制，失败时用普通 WRITE）
+                struct iovec iov[URING_BUFS];
+                for (unsigned i = 0; i < URING_BUFS; ++i)
+                {
+                    if (i > 0)
+                        ustore_[i].resize(buf_.size());
+                    u.bufs[i] = i == 0 ? buf_.data() : ustore_[i].data();
+                    iov[i].iov_base = u.bufs[i];
+                    iov[i].iov_len = buf_.size();
+                }
+                u.fixed = uring_op_ok_(pr, IORING_OP_WRITE_FIXED) &&
+                          ::syscall(__NR_io_uring_register, rfd, IORING_REGISTER_BUFFERS, iov, URING_BUFS) == 0;
+                struct stat st{};
+                u.off = (::fstat(fd_, &st) == 0) ? (unsigned long long)st.st_size : 0;
+                ur_ = u;
             }
 
-            static int buildPrefix_(char* buf, size_t cap, Level lv, const char* file_short, int line, const char* time_c, int ms)
+            static bool uring_op_ok_(const io_uring_probe* pr, unsigned op)
             {
-#if defined(_WIN32)
-                return _snprintf(buf, (unsigned)cap, "%s.%03d %s [%s:%d] ", time_c, ms, levelToStringC_(lv), file_short, line);
-#else
-                return std::snprintf(buf, cap, "%s.%03d %s [%s:%d] ", time_c, ms, levelToStringC_(lv), file_short, line);
-#endif
+                return op <= pr->last_op && op < pr->ops_len && (pr->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
             }
 
-            std::string maybeTruncate_(const std::string& s) const
+            void uring_close_()
             {
-                if (s.size() <= MAX_LOG_MESSAGE_SIZE)
-                    return s;
-                std::string r = s.substr(0, MAX_LOG_MESSAGE_SIZE);
-                r.append(TRUNCATED_MESSAGE);
-                return r;
+                if (ur_.fd < 0)
+                    return;
+                uring_wait_();
+                if (ur_.cq_ptr != ur_.sq_ptr)
+                    ::munmap(ur_.cq_ptr, ur_.cq_sz);
+                ::munmap(ur_.sq_ptr, ur_.sq_sz);
+                ::munmap(ur_.sqes, ur_.sqes_sz);
+                ::close(ur_.fd); // 同时注销登记缓冲
+                if (ur_.cur != 0) // buf_ 换回首块（此时 len_ 为 0），其余块留在 ustore_ 待下次复用
+                {
+                    buf_.swap(ustore_[ur_.cur]);
+                    buf_.swap(ustore_[0]);
+                }
+                ur_ = Uring_();
             }
 
-            static std::string& tls_buf_()
+            io_uring_sqe* uring_sqe_()
             {
-                thread_local std::string buf;
-                if (buf.capacity() < 256)
-                    buf.reserve(256);
-                buf.clear();
-                return buf;
+                const unsigned tail = *ur_.sq_tail;
+                const unsigned idx = tail & *ur_.sq_mask;
+                io_uring_sqe* sqe = &ur_.sqes[idx];
+                std::memset(sqe, 0, sizeof(*sqe));
+                ur_.sq_array[idx] = idx;
+                __atomic_store_n(ur_.sq_tail, tail + 1, __ATOMIC_RELEASE);
+                return sqe;
             }
 
-            static const char* levelToStringC_(Level lv)
+            // 提交当前缓冲块（datasync 时附带一个 IO_DRAIN 的 fdatasync：待此前所有写完成后才执行），不等待完成；
+            // 随后换到一块空闲的继续填充。内核未全部接收时此后不再使用 io_uring
+            void uring_submit_(bool datasync)
             {
-                switch (lv)
+                int w = -1;
+                if (len_ > 0)
                 {
-                case Level::Debug:
-                    return "DEBUG";
-                case Level::Info:
-                    return "INFO";
-                case Level::Notice:
-                    return "NOTICE";
-                case Level::Warning:
-                    return "WARNING";
-                case Level::Error:
-                    return "ERROR";
-                case Level::Critical:
-                    return "CRITICAL";
-                case Level::Alert:
-                    return "ALERT";
-                default:
-                    return "";
+                    w = (int)ur_.cur;
+                    Uring_::Io& io = ur_.io[w];
+                    io.ptr = buf_.data();
+                    io.len = len_;
+                    io.off = ur_.off;
+                    io.busy = true;
+                    ur_.off += len_;
+                    len_ = 0;
                 }
+                const bool ok = uring_issue_(w, datasync);
+                if (w >= 0)
+                    uring_switch_();
+                if (!ok)
+                    uring_disable_();
             }
 
-            // 默认前缀路径（未设置 pattern 时）
-            void formatMessageFast_DefaultPrefix_(Level lv, const char* file_short, int line,
-                                                  const char* time_c, int ms_count,
-                                                  const std::string& msg, std::string& out) const
+            // buf_ 换成一块空闲缓冲：先顺带收取已完成的写，各块都在途时才等待
+            void uring_switch_()
             {
-                char prefix[192];
-                int plen = buildPrefix_(prefix, sizeof(prefix), lv, file_short, line, time_c, ms_count);
-                if (plen < 0)
+                for (;;)
                 {
-                    out.assign(msg);
-                    return;
+                    for (unsigned i = 0; i < URING_BUFS; ++i)
+                        if (i != ur_.cur && !ur_.io[i].busy)
+                        {
+                            buf_.swap(ustore_[ur_.cur]);
+                            buf_.swap(ustore_[i]);
+                            ur_.cur = i;
+                            return;
+                        }
+                    if (!uring_reap_(true))
+                        return; // 环已失效：uring_reap_ 已把在途块标为空闲或置 bad
                 }
-                out.reserve((size_t)plen + msg.size());
-                out.append(prefix, (size_t)plen);
-                out.append(msg);
             }
 
-            void writeToTargets_(const std::string& formatted, bool isNewLine, Level lv)
+            // 提交缓冲块 w（-1 表示无写）的剩余部分，可附带 fdatasync。io_uring_enter 可能只接收一部分 SQE：
+            // 继续提交余下的；仍无进展时撤回未接收的（无 SQPOLL，内核只在 enter 时读取），写改为同步 pwrite，
+            // fdatasync 记到在途请求完成之后补做，返回 false
+            bool uring_issue_(int w, bool datasync)
             {
-                struct InLogGuard
+                unsigned cnt = 0;
+                if (w >= 0)
                 {
-                    InLogGuard() { ML_Logger::in_logging_flag_() = true; }
-                    ~InLogGuard() { ML_Logger::in_logging_flag_() = false; }
-                } guard;
-                std::lock_guard<std::mutex> lk(_mutex);
-                if (_need_day_switch.exchange(false, std::memory_order_relaxed))
-                    onDayChangeLocked_();
-                if (_outputToFile && !_initialized)
+                    const Uring_::Io& io = ur_.io[w];
+                    io_uring_sqe* e = uring_sqe_();
+                    e->opcode = ur_.fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+                    e->fd = fd_;
+                    e->addr = (unsigned long long)(uintptr_t)io.ptr;
+                    e->len = (unsigned)io.len;
+                    e->off = io.off;
+                    e->buf_index = (unsigned short)w;
+                    e->user_data = (unsigned long long)w;
+                    ++cnt;
+                }
+                if (datasync)
                 {
-                    rollFiles_();
-                    _initialized = true;
+                    io_uring_sqe* f = uring_sqe_();
+                    f->opcode = IORING_OP_FSYNC;
+                    f->flags = IOSQE_IO_DRAIN;
+                    f->fd = fd_;
+                    f->fsync_flags = IORING_FSYNC_DATASYNC;
+                    f->user_data = URING_TAG_FSYNC;
+                    ++cnt;
                 }
-                if (_outputToFile)
-                    writeToFile_(formatted, isNewLine);
-                if (_outputToScreen)
-                    writeToScreen_(formatted, isNewLine, lv);
+                unsigned done = 0;
+                while (done < cnt)
+                {
+                    const int r = (int)::syscall(__NR_io_uring_enter, ur_.fd, cnt - done, 0, 0, nullptr, 0);
+                    if (r < 0 && errno == EINTR)
+                        continue;
+                    if (r <= 0)
+                        break;
+                    done += (unsigned)r;
+                }
+                ur_.inflight += done;
+                if (w >= 0 && done > 0)
+                    ++ur_.writes;
+                if (done == cnt)
+                    return true;
+                __atomic_store_n(ur_.sq_tail, *ur_.sq_tail - (cnt - done), __ATOMIC_RELEASE);
+                if (w >= 0 && done == 0)
+                {
+                    Uring_::Io& io = ur_.io[w];
+                    pwrite_all_(io.ptr, io.len, io.off);
+                    writeback_tick_(io.len);
+                    io.busy = false;
+                }
+                if (datasync)
+                    ur_.need_sync = true;
+                return false;
             }
 
-            void writeToFile_(const std::string& s, bool isNewLine)
+            // 收取完成事件：block 时至少等到一个。写错误置 bad；短写把剩余部分重新提交（块保持在途）。
+            // 环本身出错时把在途块全部标为空闲、置 bad 并返回 false
+            bool uring_reap_(bool block)
             {
-                if (!_outputToFile)
-                    return;
-
-                // NEW: 周期性自愈（POSIX unlink 检测）
-                maybeHealUnlinked_(); // <== 新增
-
-                if (!_file.is_open())
+                bool got = false;
+                while (ur_.inflight > 0)
                 {
-                    rollFiles_();
-                    _initialized = true;
-                    if (!_file.is_open())
+                    const unsigned head = *ur_.cq_head;
+                    if (head == __atomic_load_n(ur_.cq_tail, __ATOMIC_ACQUIRE))
                     {
-                        reportError_(std::string("Failed to open file. Message: ") + s);
-                        return;
+                        if (got || !block)
+                            return true;
+                        const int r = (int)::syscall(__NR_io_uring_enter, ur_.fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                        if (r < 0 && errno != EINTR)
+                        {
+                            failed_ = true;
+                            ur_.inflight = 0;
+                            for (auto& io : ur_.io)
+                                io.busy = false;
+                            return false;
+                        }
+                        continue;
                     }
-                }
-
-                const size_t msg_size = s.size() + (isNewLine ? 1u : 0u);
-                if (_currentSize > 0 && (_currentSize + msg_size > _maxSizeInBytes))
-                    rollFiles_();
-
-                // 写入（一次 append）
-                _file.write(s.data(), s.size());
-                if (isNewLine)
-                    _file.put('\n');
-
-                // NEW: 写失败 → 尝试重开同一路径并重试一次
-                if (_file.bad())
-                {
-                    // 保存要重试的数据
-                    const char* p1 = s.data();
-                    size_t len1 = s.size();
-                    char nl = '\n';
-
-                    _file.close();
-                    if (_curFilePath.empty())
+                    const io_uring_cqe& c = ur_.cqes[head & *ur_.cq_mask];
+                    const int res = c.res;
+                    const unsigned long long tag = c.user_data;
+                    __atomic_store_n(ur_.cq_head, head + 1, __ATOMIC_RELEASE);
+                    --ur_.inflight;
+                    got = true;
+                    if (tag == URING_TAG_FSYNC)
                     {
-                        _initialized = false;
-                        reportError_("Log write failed and no current path.");
-                        return;
+                        if (res < 0)
+                            failed_ = true;
+                        continue;
                     }
-
-                    _file.open(_curFilePath, std::ios::out | std::ios::app | std::ios::binary);
-                    if (_file.is_open())
+                    if (tag >= URING_BUFS)
+                        continue;
+                    Uring_::Io& io = ur_.io[tag];
+                    if (res <= 0)
                     {
-                        _file.write(p1, len1);
-                        if (isNewLine)
-                            _file.put(nl);
+                        failed_ = true;
+                        io.busy = false;
+                        continue;
                     }
-
-                    if (_file.bad())
+                    writeback_tick_((size_t)res);
+                    if ((size_t)res < io.len)
                     {
-                        reportError_("Log write retry failed.");
-                        _file.close();
-                        _initialized = false; // 让下一次触发 rollFiles_()
-                        return;
+                        io.ptr += res;
+                        io.len -= (size_t)res;
+                        io.off += (unsigned long long)res;
+                        ++ur_.reissued;
+                        (void)uring_issue_((int)tag, false);
+                        continue;
                     }
+                    io.busy = false;
                 }
+                return true;
+            }
 
-                if (_auto_flush)
-                    _file.flush();
-                if (_file.bad())
+            // 等待在途请求全部完成；未被接收的 fdatasync 在此补做
+            void uring_wait_()
+            {
+                while (ur_.inflight > 0 && uring_reap_(true))
                 {
-                    reportError_("Log flush failed.");
-                    _file.close();
-                    _initialized = false;
-                    return;
                 }
+                if (ur_.need_sync)
+                {
+                    ur_.need_sync = false;
+                    sync_fd_();
+                }
+            }
 
-                _currentSize += msg_size;
-                if (_currentSize >= _maxSizeInBytes)
-                    rollFiles_();
+            // 退回普通 write：等已接收的请求完成（uring_close_ 内），文件位置定到已提交数据之后
+            void uring_disable_()
+            {
+                const unsigned long long off = ur_.off;
+                uring_close_();
+                (void)::lseek(fd_, (off_t)off, SEEK_SET);
             }
 
-            static bool supportsAnsiColor_()
+            void pwrite_all_(const char* p, size_t n, unsigned long long off)
             {
-                static std::once_flag flag;
-                static bool cached = false;
-                std::call_once(flag, []
-                               {
-#if defined(_WIN32)
-                                   int fd = _fileno(stdout);
-                                   if (fd < 0 || !_isatty(fd))
-                                   {
-                                       cached = false;
-                                       return;
-                                   }
-                                   HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
-                                   DWORD mode = 0;
-                                   if (h && GetConsoleMode(h, &mode) && SetConsoleMode(h, mode | MLLOG_VT_ENABLE))
-                                       cached = true;
-                                   else
-                                       cached = false;
-#else
-                                   cached = ::isatty(STDOUT_FILENO);
+                while (n > 0)
+                {
+                    const ssize_t w = ::pwrite(fd_, p, n, (off_t)off);
+                    if (w < 0 && errno == EINTR)
+                        continue;
+                    if (w <= 0)
+                    {
+                        failed_ = true;
+                        return;
+                    }
+                    p += w;
+                    n -= (size_t)w;
+                    off += (unsigned long long)w;
+                }
+            }
+
+            Uring_ ur_;
+            std::vector<char> ustore_[URING_BUFS]; // 各块缓冲的存放处：buf_ 持有当前块时对应项为空
 #endif
-                               });
-                return cached;
+            bool uring_want_ = false;
+            size_t prealloc_ = 0;
+            size_t wb_chunk_ = 0;
+            unsigned long long wb_start_ = 0; // 尚未发起回写的起始偏移
+            unsigned long long wb_dirty_ = 0; // 其后已写入的字节数
+            bool prealloced_ = false;
+            size_t mmap_seg_ = 0;
+            bool trim_tail_ = false;
+            bool sigbus_guard_ = false;
+            int fd_;
+            size_t len_;
+            bool failed_;
+            std::vector<char> buf_;
+        };
+
+        /* ============= 异步模式：有界无锁 MPSC 环形队列（Vyukov 序号槽） ============= */
+        // 多生产者通过 CAS 抢占槽位；单消费者（调用方保证互斥）按序取出。
+        // 槽位对象在构造时一次性分配并常驻，生产者只在槽内做拷贝，不做分配。
+        template <class T>
+        class ML_MpscRing
+        {
+        public:
+            template <class Init>
+            ML_MpscRing(size_t capacity, Init&& init)
+                : _mask(0), _head(0)
+            {
+                size_t cap = 2;
+                while (cap < capacity)
+                    cap <<= 1;
+                _mask = cap - 1;
+                _cells.reset(new Cell[cap]);
+                for (size_t i = 0; i < cap; ++i)
+                {
+                    _cells[i].seq.store(i, std::memory_order_relaxed);
+                    init(_cells[i].value);
+                }
+                _tail_line.pos.store(0, std::memory_order_relaxed);
             }
 
-            static std::mutex& console_mutex_()
+            ML_MpscRing(const ML_MpscRing&) = delete;
+            ML_MpscRing& operator=(const ML_MpscRing&) = delete;
+
+            size_t capacity() const { return _mask + 1; }
+
+            // 生产者：队列满返回 false；成功时 fill(T&) 在已占有的槽内写数据，随后发布
+            template <class Fill>
+            bool try_push(Fill&& fill)
             {
-                static std::mutex m;
-                return m;
+                size_t pos = _tail_line.pos.load(std::memory_order_relaxed);
+                for (;;)
+                {
+                    Cell& c = _cells[pos & _mask];
+                    const size_t seq = c.seq.load(std::memory_order_acquire);
+                    const std::ptrdiff_t dif = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+                    if (dif == 0)
+                    {
+                        if (_tail_line.pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        {
+                            fill(c.value);
+                            c.seq.store(pos + 1, std::memory_order_release);
+                            return true;
+                        }
+                    }
+                    else if (dif < 0)
+                        return false;
+                    else
+                        pos = _tail_line.pos.load(std::memory_order_relaxed);
+                }
             }
 
-            void writeToScreen_(const std::string& s, bool isNewLine, Level lv)
+            // 单消费者：无数据（或头部槽位尚未发布）返回 false
+            template <class Take>
+            bool try_pop(Take&& take)
             {
-                const bool colorize = _log_screen_color && supportsAnsiColor_();
-                std::lock_guard<std::mutex> g(console_mutex_());
-                if (colorize)
-                    std::cout << levelColorAnsi_(lv);
-                std::cout << s;
-                if (isNewLine)
-                    std::cout << '\n';
-                if (colorize)
-                    std::cout << MLLOG_COLOR_RESET;
+                Cell& c = _cells[_head & _mask];
+                const size_t seq = c.seq.load(std::memory_order_acquire);
+                if (seq != _head + 1)
+                    return false;
+                take(c.value);
+                c.seq.store(_head + _mask + 1, std::memory_order_release);
+                ++_head;
+                return true;
             }
 
-            void onDayChangeLocked_()
+            // 已被生产者占有的槽位总数（单调递增），flush() 用它作为“截至此刻”的水位
+            size_t pushed() const { return _tail_line.pos.load(std::memory_order_acquire); }
+            bool empty_approx() const
             {
-                if (_file.is_open())
-                    _file.close();
-                _initialized = false;
-                _isRoll = false;
-                _currentRollIndex = 0;
-                _currentSize = 0;
-                _start_timestamp = currentTimestamp_();
-                _baseFullNameWithDateAndTime = _baseName + "_" + _start_timestamp;
-                _curFilePath.clear();
-                _heal_counter = 0;
+                const Cell& c = _cells[_head & _mask];
+                return c.seq.load(std::memory_order_acquire) != _head + 1;
             }
 
-            void rollFiles_()
+        private:
+            struct Cell
             {
-                if (_baseName.empty())
-                    return;
-                size_t p = _baseName.find_last_of("\\/");
-                if (p != std::string::npos)
-                {
-                    std::string dir = _baseName.substr(0, p);
-                    platform_createDirectories_(dir);
-                }
-                if (_file.is_open())
-                    _file.close();
+                std::atomic<size_t> seq;
+                T value;
+            };
+            // 生产者游标独占缓存行，避免与消费者状态伪共享
+            struct PaddedCursor
+            {
+                char pad_before[64];
+                std::atomic<size_t> pos;
+                char pad_after[64];
+            };
+            size_t _mask;
+            std::unique_ptr<Cell[]> _cells;
+            PaddedCursor _tail_line; // 生产者共享
+            size_t _head;            // 仅消费者访问
+        };
 
-                _currentRollIndex++;
-                if (_currentRollIndex > _maxRolls)
+        /* ============= 异步模式：每线程 SPSC 字节环（变长帧） ============= */
+        // 帧格式：[u32 帧长][u32 保留][载荷]，按 8 字节对齐；尾部空间不足时写入 PAD 帧并回绕到 0。
+        // 生产者/消费者各自缓存对方游标，常态下不触碰对方的缓存行。
+        class ML_SpscByteRing
+        {
+        public:
+            explicit ML_SpscByteRing(size_t capacity)
+                : _mask(0)
+            {
+                size_t cap = 4096;
+                while (cap < capacity)
+                    cap <<= 1;
+                _mask = cap - 1;
+                _buf.reset(new char[cap]);
+                _prod.tail.store(0, std::memory_order_relaxed);
+                _prod.head_cache = 0;
+                _prod.reserved = 0;
+                _cons.head.store(0, std::memory_order_relaxed);
+                _cons.tail_cache = 0;
+                _cons.peeked = 0;
+            }
+
+            ML_SpscByteRing(const ML_SpscByteRing&) = delete;
+            ML_SpscByteRing& operator=(const ML_SpscByteRing&) = delete;
+
+            // 单帧载荷上限：保证任何位置都能放下（含回绕填充）
+            size_t max_payload() const { return ((_mask + 1) >> 1) - HDR; }
+
+            // 生产者：预留 n 字节载荷，空间不足返回 nullptr；随后必须 commit()
+            char* reserve(size_t n)
+            {
+                if (n > max_payload())
+                    return nullptr;
+                const size_t cap = _mask + 1;
+                const size_t frame = align_(n + HDR);
+                const size_t tail = _prod.tail.load(std::memory_order_relaxed);
+                const size_t off = tail & _mask;
+                const size_t pad = (cap - off < frame) ? (cap - off) : 0;
+                if (tail + pad + frame - _prod.head_cache > cap)
                 {
-                    _isRoll = true;
-                    _currentRollIndex = 1;
+                    _prod.head_cache = _cons.head.load(std::memory_order_acquire);
+                    if (tail + pad + frame - _prod.head_cache > cap)
+                        return nullptr;
                 }
+                if (pad)
+                    put_u32_(off, PAD_MARK);
+                const size_t at = (tail + pad) & _mask;
+                put_u32_(at, (uint32_t)n);
+                _prod.reserved = pad + frame;
+                return _buf.get() + at + HDR;
+            }
+            void commit() { _prod.tail.store(_prod.tail.load(std::memory_order_relaxed) + _prod.reserved, std::memory_order_release); }
 
-                std::ostringstream fn;
-                fn << _baseFullNameWithDateAndTime << '_' << _currentRollIndex << ".log";
-                _curFilePath = fn.str(); // <== 记录当前文件路径
-                _file.open(_curFilePath, std::ios::out | (_isRoll ? std::ios::trunc : std::ios::app) | std::ios::binary);
-                if (!_file.is_open())
+            // 消费者：查看下一帧（不移除），无数据返回 nullptr
+            const char* peek(size_t& n)
+            {
+                size_t head = _cons.head.load(std::memory_order_relaxed);
+                for (;;)
                 {
-                    reportError_(std::string("Failed to open new log file: ") + _curFilePath);
-                    _currentSize = 0;
-                    return;
+                    if (head == _cons.tail_cache)
+                    {
+                        _cons.tail_cache = _prod.tail.load(std::memory_order_acquire);
+                        if (head == _cons.tail_cache)
+                            return nullptr;
+                    }
+                    const size_t off = head & _mask;
+                    const uint32_t len = get_u32_(off);
+                    if (len == PAD_MARK)
+                    {
+                        head += (_mask + 1) - off;
+                        _cons.head.store(head, std::memory_order_release);
+                        continue;
+                    }
+                    n = len;
+                    _cons.peeked = align_(len + HDR);
+                    return _buf.get() + off + HDR;
                 }
+            }
+            void release() { _cons.head.store(_cons.head.load(std::memory_order_relaxed) + _cons.peeked, std::memory_order_release); }
 
-                _file.seekp(0, std::ios::end);
-                std::streampos pos = _file.tellp();
-                _currentSize = (pos >= 0) ? (size_t)pos : 0u;
-                _heal_counter = 0;
+            // 累计写入/读取字节位置（单调递增），flush() 用来判断“截至此刻”的数据是否已写出
+            size_t produced() const { return _prod.tail.load(std::memory_order_acquire); }
+            size_t consumed() const { return _cons.head.load(std::memory_order_acquire); }
+
+        private:
+            static constexpr size_t HDR = 8;
+            static constexpr uint32_t PAD_MARK = 0xFFFFFFFFu;
+            static size_t align_(size_t n) { return (n + 7u) & ~(size_t)7u; }
+            void put_u32_(size_t off, uint32_t v) { std::memcpy(_buf.get() + off, &v, sizeof(v)); }
+            uint32_t get_u32_(size_t off) const
+            {
+                uint32_t v;
+                std::memcpy(&v, _buf.get() + off, sizeof(v));
+                return v;
             }
+            // 生产者与消费者各占独立缓存行
+            struct ProducerLine
+            {
+                char pad_before[64];
+                std::atomic<size_t> tail;
+                size_t head_cache;
+                size_t reserved;
+                char pad_after[64];
+            };
+            struct ConsumerLine
+            {
+                std::atomic<size_t> head;
+                size_t tail_cache;
+                size_t peeked;
+                char pad_after[64];
+            };
+            size_t _mask;
+            std::unique_ptr<char[]> _buf;
+            ProducerLine _prod;
+            ConsumerLine _cons;
+        };
 
-            std::string currentTimestamp_() const
+        /* ============= 异步控制台写出（stdout/stderr 各一个进程级实例） ============= */
+        // 调用线程只把已上色的整行追加进有界缓冲；后台线程交换缓冲后每批一次 writev(2) 直写 fd，绕过 std::cout。
+        // 缓冲满时丢弃新行并计数，下一批前补一行丢弃统计；单行超过整个容量时等缓冲写完后在调用线程直接写出。实例永不销毁，进程退出时（atexit）写完剩余内容
+        class ML_AsyncConsole
+        {
+        public:
+            static ML_AsyncConsole& out()
             {
-                auto now = std::chrono::system_clock::now();
-                std::time_t t = std::chrono::system_clock::to_time_t(now);
-                std::tm lt{};
-#if defined(_WIN32)
-                localtime_s(&lt, &t);
-#else
-                localtime_r(&t, &lt);
-#endif
-                char buf[64];
-                if (_default_file_name_day)
-                    std::strftime(buf, sizeof(buf), "%Y%m%d", &lt);
-                else
-                    std::strftime(buf, sizeof(buf), "%Y%m%d%H%M", &lt);
-                return std::string(buf);
+                static ML_AsyncConsole* c = new ML_AsyncConsole(1);
+                return *c;
+            }
+            static ML_AsyncConsole& err()
+            {
+                static ML_AsyncConsole* c = new ML_AsyncConsole(2);
+                return *c;
             }
 
-            const char* levelColorAnsi_(Level lv) const
+            // 启动后台线程（幂等）；capacity 只增不减
+            void start(size_t capacity)
             {
-                switch (lv)
-                {
-                case Level::Debug:
-                    return MLLOG_COLOR_GREEN;
-                case Level::Info:
-                    return MLLOG_COLOR_CYAN;
-                case Level::Notice:
-                    return MLLOG_COLOR_BLUE;
-                case Level::Warning:
-                    return MLLOG_COLOR_YELLOW;
-                case Level::Error:
-                    return MLLOG_COLOR_RED;
-                case Level::Critical:
-                    return MLLOG_COLOR_MAGENTA;
-                case Level::Alert:
-                    return MLLOG_COLOR_WHITE;
-                default:
-                    return MLLOG_EMPTY;
-                }
+                std::lock_guard<std::mutex> lk(_mutex);
+                _cap = ml_max(_cap, ml_max<size_t>(capacity, 4096u));
+                if (_started)
+                    return;
+                _started = true;
+                _thread = std::thread([this] { run_(); });
+                _thread.detach();
+                static std::once_flag exit_hook;
+                std::call_once(exit_hook, [] { std::atexit(&ML_AsyncConsole::drainAll_); });
+            }
+            bool started() const
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                return _started;
             }
 
-            void reportError_(const std::string& m)
+            // 追加一行：color/reset 可为空；放不下时丢弃并返回 false。超过容量的行永远放不下：
+            // 等已排队的内容写完后持锁直接写出（其他线程的行排在其后，顺序不乱）
+            bool write(const char* color, const char* s, size_t n, bool newline, const char* reset)
             {
-                if (in_logging_flag_())
+                const size_t cn = color ? std::strlen(color) : 0;
+                const size_t rn = reset ? std::strlen(reset) : 0;
+                const size_t total = cn + n + (newline ? 1u : 0u) + rn;
                 {
-                    try
+                    std::unique_lock<std::mutex> lk(_mutex);
+                    if (total > _cap)
                     {
-                        std::cerr << "MLLOG CRITICAL: " << m << std::endl;
+                        _cv.notify_one();
+                        _drained_cv.wait(lk, [this] { return _buf.empty() && !_writing; });
+                        std::string line;
+                        line.reserve(total);
+                        line.append(color, cn);
+                        line.append(s, n);
+                        if (newline)
+                            line.push_back('\n');
+                        line.append(reset, rn);
+                        writeFd_(line.data(), line.size());
+                        return true;
                     }
-                    catch (...)
+                    if (_buf.size() + total > _cap)
                     {
+                        _dropped.fetch_add(1, std::memory_order_relaxed);
+                        ++_unreported;
+                        return false;
                     }
-                    return;
+                    const bool was_empty = _buf.empty();
+                    _buf.append(color, cn);
+                    _buf.append(s, n);
+                    if (newline)
+                        _buf.push_back('\n');
+                    _buf.append(reset, rn);
+                    if (!was_empty)
+                        return true;
                 }
-                auto h = _error_handler;
-                if (h)
+                _cv.notify_one();
+                return true;
+            }
+
+            // 等待已追加的内容全部写出
+            void drain()
+            {
+                std::unique_lock<std::mutex> lk(_mutex);
+                if (!_started)
+                    return;
+                _cv.notify_one();
+                _drained_cv.wait(lk, [this] { return _buf.empty() && !_writing; });
+            }
+
+            size_t droppedCount() const { return _dropped.load(std::memory_order_relaxed); }
+
+        private:
+            explicit ML_AsyncConsole(int fd) : _fd(fd) {}
+
+            static void drainAll_()
+            {
+                out().drain();
+                err().drain();
+            }
+
+            void run_()
+            {
+                std::string batch;
+                std::string note;
+                for (;;)
                 {
-                    try
                     {
-                        h(std::string("MLLOG INTERNAL: ") + m);
+                        std::unique_lock<std::mutex> lk(_mutex);
+                        _cv.wait(lk, [this] { return !_buf.empty() || _unreported > 0; });
+                        batch.swap(_buf);
+                        note.clear();
+                        if (_unreported > 0)
+                        {
+                            note = "MLLOG: " + std::to_string(_unreported) + " console lines dropped (buffer full)\n";
+                            _unreported = 0;
+                        }
+                        _writing = true;
                     }
-                    catch (...)
+                    writeAll_(note, batch);
+                    batch.clear();
+                    if (batch.capacity() > _cap * 2)
+                        std::string().swap(batch);
                     {
+                        std::lock_guard<std::mutex> lk(_mutex);
+                        _writing = false;
                     }
+                    _drained_cv.notify_all();
                 }
-                else
+            }
+
+            void writeAll_(const std::string& a, const std::string& b)
+            {
+#if defined(_WIN32)
+                writeFd_(a.data(), a.size());
+                writeFd_(b.data(), b.size());
+#else
+                struct iovec iov[2];
+                int cnt = 0;
+                if (!a.empty())
+                    iov[cnt++] = iovec{const_cast<char*>(a.data()), a.size()};
+                if (!b.empty())
+                    iov[cnt++] = iovec{const_cast<char*>(b.data()), b.size()};
+                size_t total = a.size() + b.size();
+                ssize_t w;
+                do
+                    w = ::writev(_fd, iov, cnt);
+                while (w < 0 && errno == EINTR);
+                if (w < 0 || (size_t)w == total)
+                    return;
+                // 部分写出（管道满等）：剩余部分逐段补写
+                size_t done = (size_t)w;
+                if (done < a.size())
                 {
-                    try
-                    {
-                        std::cerr << "MLLOG CRITICAL: " << m << std::endl;
-                    }
-                    catch (...)
-                    {
-                    }
+                    writeFd_(a.data() + done, a.size() - done);
+                    done = a.size();
                 }
+                writeFd_(b.data() + (done - a.size()), b.size() - (done - a.size()));
+#endif
             }
 
-            static bool platform_createDirectories_(const std::string& path)
+            void writeFd_(const char* p, size_t n)
             {
+                while (n > 0)
+                {
 #if defined(_WIN32)
-                if (path.empty())
-                    return true;
+                    const int w = ::_write(_fd, p, (unsigned)ml_min<size_t>(n, 1u << 30));
+#else
+                    const ssize_t w = ::write(_fd, p, n);
+                    if (w < 0 && errno == EINTR)
+                        continue;
+#endif
+                    if (w <= 0)
+                        return; // 控制台不可写：放弃本批
+                    p += w;
+                    n -= (size_t)w;
+                }
+            }
 
-                std::string p = path;
-                std::replace(p.begin(), p.end(), '/', '\\');
+            const int _fd;
+            mutable std::mutex _mutex;
+            std::condition_variable _cv;
+            std::condition_variable _drained_cv;
+            std::string _buf;
+            size_t _cap = 0;
+            size_t _unreported = 0;
+            bool _started = false;
+            bool _writing = false;
+            std::atomic<size_t> _dropped{0};
+            std::thread _thread;
+        };
 
-                std::string cur;
-                size_t i = 0;
+        /* ============= 后台文件滚动（进程级单线程） ============= */
+        // 执行滚动相关的慢操作：建目录并预开下一分段、写出并关闭换下的旧分段。任务不访问 logger，
+        // 只持有各自的共享状态。实例为静态对象，先于 Registry 构造（见 ML_LoggerRegistry::getInstance），
+        // 因而在各 logger 的退出 flush 之后析构：析构时执行完剩余任务并 join 后台线程。
+        // 析构之后（更晚析构的静态对象里写日志）投递的任务在调用线程上直接执行
+        class ML_FileRoller
+        {
+        public:
+            static ML_FileRoller& instance()
+            {
+                static ML_FileRoller r;
+                return r;
+            }
 
-                // UNC: \\server\share\...
-                if (p.size() >= 2 && p[0] == '\\' && p[1] == '\\')
+            ~ML_FileRoller()
+            {
                 {
-                    size_t j = p.find('\\', 2);
-                    if (j == std::string::npos)
-                        return false; // \\server
-                    size_t k = p.find('\\', j + 1);
-                    if (k == std::string::npos)
-                        return false;     // \\server\share (缺少后续分隔)
-                    cur = p.substr(0, k); // \\server\share
-                    i = k + 1;            // 跳过 '\'
-                    // UNC 根不 mkdir
+                    std::lock_guard<std::mutex> lk(_mutex);
+                    _stop = true;
                 }
-                // 盘符: X:\...
-                else if (p.size() >= 2 && std::isalpha((unsigned char)p[0]) && p[1] == ':')
+                _cv.notify_one();
+                if (_thread.joinable())
+                    _thread.join();
+                stopped_().store(true, std::memory_order_release);
+            }
+
+            // 投递任务（首次投递时启动后台线程）
+            void post(std::function<void()> job)
+            {
+                if (stopped_().load(std::memory_order_acquire))
                 {
-                    cur = p.substr(0, 2); // "X:"
-                    i = 2;
-                    if (i < p.size() && p[i] == '\\')
-                    {
-                        cur += '\\';
-                        ++i;
-                    } // "X:\"
-                    // 不对 "X:" / "X:\" 调 mkdir
+                    runJob_(job);
+                    return;
                 }
-
-                // 逐段创建
-                while (i < p.size())
                 {
-                    while (i < p.size() && p[i] == '\\')
-                        ++i;
-                    if (i >= p.size())
-                        break;
-                    size_t j = p.find('\\', i);
-                    std::string seg = (j == std::string::npos) ? p.substr(i) : p.substr(i, j - i);
-                    i = (j == std::string::npos) ? p.size() : j + 1;
+                    std::lock_guard<std::mutex> lk(_mutex);
+                    _jobs.push_back(std::move(job));
+                    if (!_thread.joinable())
+                        _thread = std::thread(&ML_FileRoller::run_, this);
+                }
+                _cv.notify_one();
+            }
 
-                    if (seg.empty() || seg == ".")
-                        continue;
+            // 等待已投递的任务全部完成
+            void drain()
+            {
+                if (stopped_().load(std::memory_order_acquire))
+                    return;
+                std::unique_lock<std::mutex> lk(_mutex);
+                _idle_cv.wait(lk, [this] { return _jobs.empty() && !_busy; });
+            }
 
-                    if (!cur.empty() && cur.back() != '\\')
-                        cur.push_back('\\');
-                    cur += seg;
+        private:
+            ML_FileRoller() = default;
+            ML_FileRoller(const ML_FileRoller&) = delete;
+            ML_FileRoller& operator=(const ML_FileRoller&) = delete;
 
-                    if (_mkdir(cur.c_str()) != 0 && errno != EEXIST)
-                        return false;
-                }
-                return true;
-#else
-                // 你的原 *nix 实现就行
-                std::string q = path;
-                std::replace(q.begin(), q.end(), '\\', '/');
-                if (q.empty())
-                    return true;
-                std::string cur = (q[0] == '/') ? std::string("/") : std::string();
-                std::stringstream ss(q);
-                std::string seg;
-                while (std::getline(ss, seg, '/'))
-                {
-                    if (seg.empty() || seg == ".")
-                        continue;
-                    if (!cur.empty() && cur.back() != '/')
-                        cur.push_back('/');
-                    cur += seg;
-                    if (::mkdir(cur.c_str(), 0755) != 0 && errno != EEXIST)
-                        return false;
-                }
-                return true;
-#endif
+            // 析构标记放在平凡析构的静态原子量里：实例析构后仍可安全读取
+            static std::atomic<bool>& stopped_()
+            {
+                static std::atomic<bool> s{false};
+                return s;
             }
 
-            static std::string platform_getModulePath_()
+            static void runJob_(std::function<void()>& job)
             {
-                char buf[1024] = {0};
-#if defined(_WIN32)
-                HMODULE h = nullptr;
-                if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
-                                       reinterpret_cast<LPCSTR>(&platform_getModulePath_), &h))
-                {
-                    char path[MAX_PATH] = {0};
-                    DWORD n = GetModuleFileNameA(h, path, MAX_PATH);
-                    if (n > 0)
-                    {
-                        std::string p(path, n);
-                        size_t pos = p.find_last_of("\\/");
-                        return (pos != std::string::npos) ? p.substr(0, pos) : ".";
-                    }
-                }
-                char* exe = nullptr;
-                if (_get_pgmptr(&exe) == 0 && exe)
+                try
                 {
-                    std::string p(exe);
-                    size_t pos = p.find_last_of("\\/");
-                    return (pos != std::string::npos) ? p.substr(0, pos) : ".";
+                    job();
                 }
-                if (_getcwd(buf, (int)sizeof(buf)))
-                    return std::string(buf);
-                return ".";
-#else
-                Dl_info info{};
-                if (dladdr((void*)(&platform_getModulePath_), &info) && info.dli_fname)
+                catch (...)
                 {
-                    std::string p(info.dli_fname);
-                    size_t pos = p.find_last_of('/');
-                    return (pos != std::string::npos) ? p.substr(0, pos) : ".";
                 }
-                if (getcwd(buf, sizeof(buf)) != nullptr)
-                    return std::string(buf);
-                return ".";
-#endif
+                job = nullptr; // 在 _busy 清除前释放任务持有的流
             }
 
-            static std::string platform_getModuleBasename_()
+            void run_()
             {
-#if defined(_WIN32)
-                HMODULE h = nullptr;
-                if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
-                                       reinterpret_cast<LPCSTR>(&platform_getModuleBasename_), &h))
+                for (;;)
                 {
-                    char path[MAX_PATH] = {0};
-                    DWORD n = GetModuleFileNameA(h, path, MAX_PATH);
-                    if (n)
+                    std::function<void()> job;
                     {
-                        std::string p(path, n);
-                        size_t pos = p.find_last_of("\\/");
-                        std::string b = (pos == std::string::npos) ? p : p.substr(pos + 1);
-                        size_t dot = b.rfind('.');
-                        if (dot != std::string::npos)
-                            b.resize(dot);
-                        return b;
+                        std::unique_lock<std::mutex> lk(_mutex);
+                        _cv.wait(lk, [this] { return !_jobs.empty() || _stop; });
+                        if (_jobs.empty()) // 停止：剩余任务已执行完
+                            return;
+                        job.swap(_jobs.front());
+                        _jobs.pop_front();
+                        _busy = true;
                     }
+                    runJob_(job);
+                    {
+                        std::lock_guard<std::mutex> lk(_mutex);
+                        _busy = false;
+                    }
+                    _idle_cv.notify_all();
                 }
-                return platform_getProcessName_();
-#else
-                Dl_info info{};
-                if (dladdr((void*)(&platform_getModuleBasename_), &info) && info.dli_fname)
-                {
-                    std::string p(info.dli_fname);
-                    size_t pos = p.find_last_of('/');
-                    std::string b = (pos == std::string::npos) ? p : p.substr(pos + 1);
-                    size_t dot = b.rfind('.');
-                    if (dot != std::string::npos)
-                        b.resize(dot);
-                    return b;
-                }
-                return platform_getProcessName_();
-#endif
             }
 
-            static std::string platform_getProcessName_()
+            std::mutex _mutex;
+            std::condition_variable _cv;
+            std::condition_variable _idle_cv;
+            std::deque<std::function<void()>> _jobs;
+            bool _busy = false;
+            bool _stop = false;
+            std::thread _thread;
+        };
+
+        /* ======================= Registry 前向声明 ======================= */
+        class ML_Logger;
+
+        class ML_LoggerRegistry
+        {
+        public:
+            static ML_LoggerRegistry& getInstance();
+            ML_Logger& get(const std::string& name);
+            ~ML_LoggerRegistry();
+
+        private:
+            ML_LoggerRegistry() = default;
+            ML_LoggerRegistry(const ML_LoggerRegistry&) = delete;
+            static void flushAllAtExit_(); // 实例永不析构：进程退出时（atexit）写出各 logger 的文件缓冲
+            ML_LoggerRegistry& operator=(const ML_LoggerRegistry&) = delete;
+
+            std::mutex _mutex;
+            std::map<std::string, std::unique_ptr<ML_Logger>> _loggers;
+            // 读路径无锁：新建 logger 时在锁内复制出新快照并原子发布；旧快照可能仍被读者持有，只保留不释放
+            using Snapshot_ = std::map<std::string, ML_Logger*>;
+            std::atomic<const Snapshot_*> _snapshot{nullptr};
+            std::vector<std::unique_ptr<Snapshot_>> _snapshots;
+        };
+
+        /* ========================= 核心类 ========================= */
+        class ML_Logger
+        {
+        public:
+            enum class Level
             {
-                char buf[1024] = {0};
-#if defined(_WIN32)
-                char* exe = nullptr;
-                if (_get_pgmptr(&exe) == 0 && exe)
+                Debug = 0,
+                Info,
+                Notice,
+                Warning,
+                Error,
+                Critical,
+                Alert
+            };
+            using ErrorHandler = std::function<void(const std::string&)>;
+            // 调用点描述符：宏在每个调用点生成一个 static const 实例，热路径只传一个指针。
+            // level/fmt 为该点首次执行时的值（宏传入的通常是常量）；id() 首次调用时分配，进程内唯一。
+            struct CallSite
+            {
+                const char* file_short;
+                const char* file_full;
+                const char* func;
+                int line;
+                Level level;
+                const char* fmt;
+
+                CallSite(const char* fs, const char* ff, const char* fn, int ln, Level lv, const char* f = nullptr)
+                    : file_short(fs), file_full(ff), func(fn), line(ln), level(lv), fmt(f), _id(0) {}
+                CallSite(const CallSite&) = delete;
+                CallSite& operator=(const CallSite&) = delete;
+
+                uint32_t id() const
                 {
-                    std::string n(exe);
-                    size_t p = n.find_last_of("\\/");
-                    if (p != std::string::npos)
-                        n = n.substr(p + 1);
-                    p = n.rfind('.');
-                    if (p != std::string::npos)
-                        n = n.substr(0, p);
-                    return n;
+                    uint32_t v = _id.load(std::memory_order_acquire);
+                    if (v)
+                        return v;
+                    static std::atomic<uint32_t> next{0};
+                    const uint32_t mine = next.fetch_add(1, std::memory_order_relaxed) + 1;
+                    return _id.compare_exchange_strong(v, mine, std::memory_order_acq_rel) ? mine : v;
                 }
-                return "unknown_process";
-#else
-                ssize_t r = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
-                if (r > 0)
-                    buf[r] = '\0';
-                if (r > 0)
+
+            private:
+                mutable std::atomic<uint32_t> _id;
+            };
+            // 日志文件格式（仅影响文件；屏幕始终输出文本）
+            enum class FileFormat
+            {
+                Text,  // 逐行文本（默认）
+                Binary // 紧凑二进制记录（.mlb），由 decodeBinaryLog() / tools/mllog_decode 离线渲染
+            };
+            // 异步队列形态
+            enum class AsyncQueue
+            {
+                Shared,   // 所有线程共享一个有界无锁 MPSC 队列（默认）
+                PerThread // 每线程独立 SPSC 字节环，写线程按时间戳归并
+            };
+            // 异步队列溢出策略
+            enum class AsyncOverflow
+            {
+                Block,      // 生产者等待空位（默认，不丢日志）
+                DropNewest, // 丢弃当前这条
+                DropOldest, // 淘汰队列中最旧的一条再入队
+                Spill       // 转入有上限的溢出缓冲，超限时淘汰其中最旧的
+            };
+            // 交给 sink 的一条记录（只读视图，仅在 Sink::write 调用期间有效）
+            struct Record
+            {
+                long long ts_ns; // 调用时刻（system_clock 纳秒）
+                Level level;
+                const char* logger;
+                const char* file_short;
+                const char* file_full;
+                const char* func;
+                int line;
+                unsigned tid;
+                const char* msg; // 正文（已渲染、已截断，不含字段）
+                size_t msg_n;
+                const char* fields; // 结构化字段编码（ML_ArgCodec，键值交替），可用 ML_ArgCodec::render_fields 渲染
+                size_t fields_n;
+            };
+            // 输出目标。write 收到按该 sink 的行格式渲染好的整行（含结尾换行）；调用时不持有 logger 的内部锁，
+            // 同步模式下可能被多个写日志的线程并发调用，需自行同步（内置 sink 均已同步）
+            class Sink
+            {
+            public:
+                virtual ~Sink() {}
+                virtual void write(const Record& rec, const char* line, size_t n) = 0;
+                virtual void flush() {}
+            };
+            // sink 的行格式；同一 logger 上格式相同的 sink 共享同一次渲染结果
+            struct SinkFormat
+            {
+                enum Kind
                 {
-                    std::string n(buf);
-                    size_t p = n.find_last_of('/');
-                    if (p != std::string::npos)
-                        n = n.substr(p + 1);
-                    return n;
-                }
-                return "unknown_process";
-#endif
-            }
+                    Inherit,     // 沿用 logger 自身（JSON-lines / message-only / pattern / 默认前缀）
+                    Pattern,     // 独立 pattern（语法同 setPattern）
+                    Json,        // JSON-lines
+                    MessageOnly  // 仅正文（字段按 logfmt 附后）
+                };
+                Kind kind;
+                std::string pattern;
 
-            static std::string platform_currentDirWithSlash_()
+                static SinkFormat inherit() { return SinkFormat{Inherit, std::string()}; }
+                static SinkFormat withPattern(const std::string& p) { return SinkFormat{Pattern, p}; }
+                static SinkFormat json() { return SinkFormat{Json, std::string()}; }
+                static SinkFormat messageOnly() { return SinkFormat{MessageOnly, std::string()}; }
+            };
+
+            static const size_t MAX_LOG_MESSAGE_SIZE = 1024u * 1024u * 5u;
+            static constexpr const char* TRUNCATED_MESSAGE = "\n... [Message Truncated]";
+            enum class Phase : int
             {
-                char buf[1024] = {0};
-#if defined(_WIN32)
-                if (_getcwd(buf, (int)sizeof(buf)) != nullptr)
-                    return std::string(buf) + "\\";
-#else
-                if (getcwd(buf, sizeof(buf)) != nullptr)
-                    return std::string(buf) + "/";
-#endif
-                return std::string();
+                Off = 0,
+                Light = 1,
+                Full = 2
+            };
+            static ML_Logger& get()
+            {
+                static ML_Logger& d = ML_LoggerRegistry::getInstance().get("default"); // 实例永不销毁，可缓存
+                return d;
+            }
+            static ML_Logger& get(const std::string& name)
+            {
+                return ML_LoggerRegistry::getInstance().get(name);
+            }
+            static ML_Logger& getInstance() { return get(); }
+            // 命名宏使用：slot 为调用点的 static 缓存；name 未变化时只做一次字符串比较，不查表
+            template <class Name>
+            static ML_Logger& getCached(std::atomic<ML_Logger*>& slot, const Name& name)
+            {
+                ML_Logger* p = slot.load(std::memory_order_acquire);
+                if (p && p->_name == name)
+                    return *p;
+                p = &get(name);
+                slot.store(p, std::memory_order_release);
+                return *p;
+            }
+            // [CHG]：带 name 的构造；Registry 会传入
+            ML_Logger(const std::string& name = "default")
+                : _name(name),
+                  _isRoll(false), _logLevel(Level::Debug),
+                  _outputToFile(true), _outputToScreen(true),
+                  _currentRollIndex(0), _maxRolls(5),
+                  _maxSizeInBytes(100u * 1024u * 1024u), _currentSize(0),
+                  _initialized(false), _message_only(false), _add_newline(true),
+                  _log_enabled(false), _log_screen_color(true),
+                  _default_file_name_day(true), _isCheckDay(false),
+                  _start_timestamp(), _last_log_ymd(0), _auto_flush(true),
+                  _need_day_switch(false), _error_handler(nullptr),
+                  _pending_bytes(0), _phase((int)Phase::Off)
+            {
+                std::string def = get_module_path() + "/log/" + platform_getModuleBasename_() + "_MLLOG";
+                setLogFile(def, _maxRolls, _maxSizeInBytes);
             }
 
-            static std::vector<std::string> platform_listLogFiles_(const std::string& dir, const std::string& stem)
+            ~ML_Logger()
             {
-                std::vector<std::string> out;
-#if defined(_WIN32)
-                std::string search = dir;
-                if (!search.empty())
+                try
                 {
-                    char back = search.back();
-                    if (back != '\\' && back != '/')
-                        search.push_back('\\');
+                    stopAsyncWriter_();
                 }
-                search += stem + "_*";
-                struct _finddata_t f;
-                intptr_t h = _findfirst(search.c_str(), &f);
-                if (h != -1)
+                catch (...)
                 {
-                    do
-                    {
-                        if (!(f.attrib & _A_SUBDIR))
-                            out.emplace_back(f.name);
-                    } while (_findnext(h, &f) == 0);
-                    _findclose(h);
                 }
-#else
-                if (DIR* d = opendir(dir.c_str()))
+                try
+                {
+                    flush();
+                }
+                catch (...)
+                {
+                }
+                try
+                {
+                    std::lock_guard<std::mutex> lk(_mutex);
+                    dropPrepared_UnsafeLocked_();
+                    if (_file.is_open())
+                        _file.close();
+                }
+                catch (...)
                 {
-                    while (dirent* e = readdir(d))
-                    {
-                        if (e->d_type == DT_REG || e->d_type == DT_LNK)
-                        {
-                            std::string n = e->d_name;
-                            if (n.rfind(stem + "_", 0) == 0)
-                                out.emplace_back(n);
-                        }
-                        else if (e->d_type == DT_UNKNOWN)
-                        {
-                            std::string full = dir;
-                            if (!full.empty() && full.back() != '/')
-                                full.push_back('/');
-                            full += e->d_name;
-                            struct stat st{};
-                            if (::stat(full.c_str(), &st) == 0 && S_ISREG(st.st_mode))
-                            {
-                                std::string n = e->d_name;
-                                if (n.rfind(stem + "_", 0) == 0)
-                                    out.emplace_back(n);
-                            }
-                        }
-                    }
-                    closedir(d);
                 }
-#endif
-                std::sort(out.begin(), out.end());
-                return out;
             }
 
-            static void platform_deleteFile_(const std::string& full)
+            ML_Logger(const ML_Logger&) = delete;
+            ML_Logger& operator=(const ML_Logger&) = delete;
+
+            /* 配置接口 */
+            void setLevel(Level lv) { _logLevel = lv; }
+            void setCheckDay(bool on) { _isCheckDay = on; }
+            void setOutput(bool toFile, bool toScreen)
             {
-                if (std::remove(full.c_str()) != 0)
+                _outputToFile = toFile;
+                _outputToScreen = toScreen;
+            }
+            void setAddNewLine(bool add) { _add_newline = add; }
+            bool getAddNewLine() const { return _add_newline; }
+            void setDefaultLogFormat(bool dateOnly) { _default_file_name_day = dateOnly; }
+            void setMessageOnly(bool msgOnly) { _message_only = msgOnly; }
+            void setScreenColor(bool on) { _log_screen_color = on; }
+            // 屏幕输出改由后台线程写出（见 ML_AsyncConsole）：调用线程只把上色后的整行追加进有界缓冲（bufferBytes，
+            // 进程内共享、取各次设置的最大值），满时丢弃并计数（getScreenDroppedCount）；超过整个缓冲的单行在调用线程直接写出。与直接写 std::cout 的输出之间
+            // 不保证先后；flush() 会等待缓冲写完。切换持 _mutex（本 logger 的上屏都在锁内），关闭时先写完缓冲再改回同步
+            void setScreenAsync(bool on, size_t bufferBytes = 1u << 20)
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                if (on)
                 {
-#if defined(_WIN32)
-                    std::cerr << "MLLOG CRITICAL: Failed to delete file: " << full << std::endl;
-#else
-                    std::cerr << "MLLOG CRITICAL: Failed to delete file: " << full << ", errno=" << errno << std::endl;
-#endif
+                    {
+                        std::lock_guard<std::mutex> cg(console_mutex_());
+                        std::cout.flush(); // 先送出同步路径已缓冲的内容，保持切换前后的顺序
+                    }
+                    ML_AsyncConsole::out().start(bufferBytes);
                 }
+                else if (_screen_async.load(std::memory_order_acquire))
+                    ML_AsyncConsole::out().drain(); // 已入缓冲的行先于此后经 std::cout 的行写出
+                _screen_async.store(on, std::memory_order_release);
+            }
+            bool getScreenAsync() const { return _screen_async.load(std::memory_order_acquire); }
+            static size_t getScreenDroppedCount() { return ML_AsyncConsole::out().droppedCount(); }
+            void setAutoFlush(bool enabled) { _auto_flush = enabled; }
+            // 组提交（取代逐条 auto-flush）：文件写入只进 stream 缓冲，未提交字节达到 maxBytes、最早一条超过 maxDelayUs、
+            // 异步写线程取空队列时，或 flush()/滚动时，整批一次写出并只 flush 一次（fsyncPerBatch 时再 fdatasync 一次）。
+            // 异步模式下取空队列即提交，maxBytes/maxDelayUs 限定持续积压时一批的大小与延迟；
+            // 同步模式下时间窗只在下一次写日志或 flush() 时检查，建议配合 setAsync 使用
+            void setGroupCommit(bool on, size_t maxBytes = 256u * 1024u, unsigned maxDelayUs = 1000, bool fsyncPerBatch = false)
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                commitGroup_UnsafeLocked_();
+                _group_commit.store(on, std::memory_order_relaxed);
+                _gc_max_bytes = ml_max<size_t>(maxBytes, 1u);
+                _gc_max_delay_us = maxDelayUs;
+                _gc_fsync = fsyncPerBatch;
             }
+            bool getGroupCommit() const { return _group_commit.load(std::memory_order_relaxed); }
+            void setErrorHandler(ErrorHandler h) { _error_handler = std::move(h); }
 
-            bool shouldDeleteLog_(const std::string& filename, int days) const
+            void setLogSwitch(bool on)
             {
-                const std::time_t ft = parseDateFromFilename_(filename);
-                if (ft == (time_t)-1)
-                    return false;
-                const std::time_t now = std::time(nullptr);
-                return std::difftime(now, ft) > double(days) * 24.0 * 3600.0;
+                _log_enabled = on;
+                if (on && phase() == Phase::Off)
+                    setPhase_(Phase::Light);
             }
+            bool getLogSwitch() const { return _log_enabled; }
+            // 宏在构造 LoggerStream / 格式化参数之前调用：false 时整条语句的参数都不求值
+            bool shouldLog(Level lv) const { return _log_enabled && lv >= _logLevel; }
 
-            std::time_t parseDateFromFilename_(const std::string& filename) const
+            // ---------- Anywhere-Safe 启停 ----------
+            void startAnywhere(bool emit_banner = true)
             {
-                if (filename.rfind(_baseNameWithoutPath + "_", 0) != 0)
-                    return (time_t)-1;
-                std::string rest = filename.substr(_baseNameWithoutPath.length() + 1);
-                if (rest.size() < 8)
-                    return (time_t)-1;
-                std::string ymd = rest.substr(0, 8);
-                for (char c : ymd)
-                    if (!std::isdigit(static_cast<unsigned char>(c)))
-                        return (time_t)-1;
-                std::tm tmv{};
-                try
+                std::lock_guard<std::mutex> lk(_mutex);
+                _log_enabled = true;
+                if (phase() == Phase::Off)
+                    setPhase_(Phase::Light);
+                if (emit_banner)
+                    enqueueStartBanner_NoIO_UnsafeLocked_();
+            }
+
+            void promoteToFull()
+            {
+                struct InLogGuard
                 {
-                    tmv.tm_year = std::stoi(ymd.substr(0, 4)) - 1900;
-                    tmv.tm_mon = std::stoi(ymd.substr(4, 2)) - 1;
-                    tmv.tm_mday = std::stoi(ymd.substr(6, 2));
-                    tmv.tm_isdst = -1;
+                    InLogGuard() { ML_Logger::in_logging_flag_() = true; }
+                    ~InLogGuard() { ML_Logger::in_logging_flag_() = false; }
+                } guard;
+                std::lock_guard<std::mutex> lk(_mutex);
+                if (phase() == Phase::Full)
+                    return;
+
+                if (!_outputToFile)
+                {
+                    setPhase_(Phase::Full);
+                    _pending_bytes = 0;
+                    _pending.clear();
+                    return;
                 }
-                catch (...)
+
+                if (!_initialized)
                 {
-                    return (time_t)-1;
+                    rollFiles_();
+                    _initialized = true;
                 }
-                return std::mktime(&tmv);
+                else if (!_file.is_open())
+                {
+                    rollFiles_();
+                }
+
+                if (!_file.is_open())
+                {
+                    reportError_("promoteToFull(): open log file failed, stay in Light.");
+                    return;
+                }
+
+                for (const auto& line : _pending)
+                {
+                    const std::string& chunk = fileChunk_(line);
+                    const size_t sz = chunk.size();
+                    if (_currentSize > 0 && (_currentSize + sz > _maxSizeInBytes))
+                        rollFiles_();
+                    _file.write(chunk.data(), sz);
+                    if (_auto_flush)
+                        _file.flush();
+                    if (_file.bad())
+                    {
+                        reportError_("promoteToFull(): flush pending failed; keeping pending.");
+                        _file.close();
+                        _initialized = false;
+                        return;
+                    }
+                    _currentSize += sz;
+                    if (_currentSize >= _maxSizeInBytes)
+                        rollFiles_();
+                }
+                _pending_bytes = 0;
+                _pending.clear();
+                setPhase_(Phase::Full);
             }
 
-            // ---------- Pattern 引擎（NEW） ----------
-            enum class PatType
+            void setLogFile(const std::string& baseName, int maxRolls = 5, size_t maxSizeInBytes = 100u * 1024u * 1024u)
             {
-                Lit,
-                DateChunk,
-                Ms,
-                LevelShort,
-                LevelLong,
-                LoggerName,
-                PID,
-                TID,
-                FileShort,
-                FileFull,
-                Line,
-                Func,
-                Message,
-                ColorStart,
-                ColorStop
-            };
+                std::lock_guard<std::mutex> lk(_mutex);
+                _baseName = baseName;
+                _maxRolls = ml_max(1, maxRolls);
+                _maxSizeInBytes = maxSizeInBytes;
+                dropPrepared_UnsafeLocked_();
+                _file.set_mmap(_file_mmap ? _maxSizeInBytes : 0);
+                _file.set_prealloc(_file_prealloc ? _maxSizeInBytes : 0, _file_prealloc ? _file_writeback : 0);
 
-            struct PatOp
-            {
-                PatType type;
-                std::string text;
-            };
+                _currentSize = 0;
+                _currentRollIndex = 0;
+                _initialized = false;
+                _isRoll = false;
 
-            // 编译 pattern 为 token 序列；把时间片段（含多种 %X 与字面）聚合成单个 DateChunk
-            static bool is_time_spec_char_(char c)
-            {
-                return std::isalpha(static_cast<unsigned char>(c)) ? true : false;
+                size_t p = _baseName.find_last_of("\\/");
+                _baseNameWithoutPath = (p != std::string::npos) ? _baseName.substr(p + 1) : _baseName;
+
+                _start_timestamp = currentTimestamp_();
+                _baseFullNameWithDateAndTime = _baseName + "_" + _start_timestamp;
+                if (_file.is_open())
+                    _file.close();
+                _curFilePath.clear();
+                _heal_counter = 0;
             }
 
-            bool compilePattern_(const std::string& p, std::vector<PatOp>& out)
+            void flush()
             {
-                if (p.empty())
-                    return false;
-                out.clear();
-                std::string lit, datechunk;
-                auto flush_lit = [&]()
-                { if (!lit.empty()) { out.push_back({ PatType::Lit, lit }); lit.clear(); } };
-                auto flush_date = [&]()
-                { if (!datechunk.empty()) { out.push_back({ PatType::DateChunk, datechunk }); datechunk.clear(); } };
-
-                for (size_t i = 0; i < p.size(); ++i)
+                waitAsyncDrained_();
+                std::shared_ptr<const SinkSet_> sinks;
                 {
-                    if (p[i] != '%')
-                    {
-                        if (!datechunk.empty())
-                            datechunk.push_back(p[i]);
-                        else
-                            lit.push_back(p[i]);
-                        continue;
-                    }
-                    if (i + 1 >= p.size())
+                    std::lock_guard<std::mutex> lk(_mutex);
+                    commitGroup_UnsafeLocked_();
+                    if (_file.is_open())
+                        _file.flush();
+                    if (_screen_async.load(std::memory_order_acquire))
+                        ML_AsyncConsole::out().drain();
+                    if (_next_seg)
                     {
-                        (datechunk.empty() ? lit : datechunk).push_back('%');
-                        break;
+                        ML_FileRoller::instance().drain(); // 换下的旧分段也已写出
+                        reportRollErrors_UnsafeLocked_();
                     }
-                    char c = p[i + 1];
-                    i++;
-                    switch (c)
-                    {
-                    case 'v':
-                        flush_date();
-                        flush_lit();
-                        out.push_back({PatType::Message, {}});
-                        break;
-                    case 'l':
-                        flush_date();
-                        flush_lit();
-                        out.push_back({PatType::LevelShort, {}});
-                        break;
-                    case 'L':
-                        flush_date();
-                        flush_lit();
-                        out.push_back({PatType::LevelLong, {}});
-                        break;
-                    case 'n':
-                        flush_date();
-                        flush_lit();
-                        out.push_back({PatType::LoggerName, {}});
-                        break;
-                    case 'P':
-                        flush_date();
-                        flush_lit();
-                        out.push_back({PatType::PID, {}});
-                        break;
-                    case 't':
-                        flush_date();
-                        flush_lit();
-                        out.push_back({PatType::TID, {}});
-                        break;
-                    case 's':
-                        flush_date();
-                        flush_lit();
-                        out.push_back({PatType::FileShort, {}});
-                        break;
-                    case 'g':
-                        flush_date();
-                        flush_lit();
-                        out.push_back({PatType::FileFull, {}});
-                        break; // [NEW] 全路径
-                    case '#':
-                        flush_date();
-                        flush_lit();
-                        out.push_back({PatType::Line, {}});
-                        break;
-                    case '!':
-                        flush_date();
-                        flush_lit();
-                        out.push_back({PatType::Func, {}});
-                        break; // [NEW] 函数名
-                    case '^':
-                        flush_date();
-                        flush_lit();
-                        out.push_back({PatType::ColorStart, {}});
-                        break;
-                    case '$':
-                        flush_date();
-                        flush_lit();
-                        out.push_back({PatType::ColorStop, {}});
+                    sinks = _sinks;
+                }
+                if (sinks) // sink 的 flush 可能等网络/磁盘，不占用 logger 锁
+                    for (const auto& e : sinks->sinks)
+                        e.sink->flush();
+            }
+
+            // ---------- 异步模式 ----------
+            // on=true：log() 只在调用线程格式化，并拷贝进有界无锁 MPSC 队列的预分配槽位，
+            //          由专用写线程批量落盘/上屏；调用线程不再争用 _mutex，也不等待 I/O。
+            // on=false：停止写线程，并把队列中剩余的记录同步写完。
+            // 仅作用于 Full 阶段；Light 阶段仍走 pending 缓存。进程退出前请调用 flush() 或 setAsync(false)。
+            // queue=PerThread：每个线程首次写日志时登记自己的 SPSC 字节环（容量见 setAsyncThreadBufferSize），
+            //          生产者之间不共享任何缓存行；queueCapacity 此时不使用。超过环容量一半的记录经溢出缓冲交给写线程，
+            //          保持同线程内的先后顺序（溢出缓冲满时按 setAsyncOverflow 等待或丢弃）。
+            void setAsync(bool on, size_t queueCapacity = 8192, AsyncQueue queue = AsyncQueue::Shared)
+            {
+                std::lock_guard<std::mutex> ck(_async_ctl_mutex);
+                if (!on)
+                {
+                    stopAsyncWriter_();
+                    return;
+                }
+                AsyncRing_* cur = _async_ring.load(std::memory_order_acquire);
+                const size_t want = ml_max<size_t>(queueCapacity, 2u);
+                if (_async_on.load(std::memory_order_acquire) && getAsyncQueue() == queue &&
+                    (queue == AsyncQueue::PerThread || (cur && cur->capacity() >= want && cur->capacity() < want * 2)))
+                    return;
+                stopAsyncWriter_();
+                if (queue == AsyncQueue::Shared && (!cur || cur->capacity() < want || cur->capacity() >= want * 2))
+                {
+                    // 旧队列只退役不释放：可能仍有生产者持有其指针（见 asyncEnqueue_ 的复查）
+                    _async_rings.emplace_back(new AsyncRing_(want, [](AsyncRecord_& r)
+                                                              { r.text.reserve(ASYNC_SLOT_RESERVE); }));
+                    _async_ring.store(_async_rings.back().get(), std::memory_order_release);
+                }
+                _async_stop.store(false, std::memory_order_relaxed);
+                _async_queue.store((int)queue, std::memory_order_relaxed);
+                _async_epoch.fetch_add(1, std::memory_order_relaxed);
+                _async_done.store(0, std::memory_order_relaxed);
+                cur = _async_ring.load(std::memory_order_relaxed);
+                _async_base.store(cur ? cur->pushed() : 0, std::memory_order_relaxed);
+                _async_on.store(true, std::memory_order_release);
+                _async_thread = std::thread([this]
+                                            { asyncWriterLoop_(); });
+            }
+            bool getAsync() const { return _async_on.load(std::memory_order_acquire); }
+            AsyncQueue getAsyncQueue() const { return (AsyncQueue)_async_queue.load(std::memory_order_relaxed); }
+            // PerThread 模式下每个线程字节环的容量（对之后新登记的线程生效）
+            void setAsyncThreadBufferSize(size_t bytes) { _async_thread_bytes.store(ml_max<size_t>(bytes, 4096u), std::memory_order_relaxed); }
+
+            // 队列满（写线程跟不上，如滚动时磁盘卡顿）时生产者的行为；丢弃的条数由写线程合成一行
+            // "N records dropped" 的 WARNING 输出，累计值可用 getAsyncDroppedCount() 查询。
+            void setAsyncOverflow(AsyncOverflow policy) { _async_overflow.store((int)policy, std::memory_order_relaxed); }
+            AsyncOverflow getAsyncOverflow() const { return (AsyncOverflow)_async_overflow.load(std::memory_order_relaxed); }
+            unsigned long long getAsyncDroppedCount() const { return _async_dropped_total.load(std::memory_order_relaxed); }
+
+            // [CHG]：log / logformat 现在额外携带 fullpath 与 func；pattern 可用 %g / %!
+            void log(const char* file_short, const char* file_full, const char* func, int line,
+                     Level lv, const std::string& original, bool isNewLine = true)
+            {
+                logAt_(file_short, file_full, func, line, lv, original.data(), original.size(), isNewLine, nullptr);
+            }
+            // 宏使用的入口：site 为调用点的 static 描述符
+            void log(const CallSite* site, Level lv, const std::string& original, bool isNewLine = true)
+            {
+                logAt_(site->file_short, site->file_full, site->func, site->line, lv, original.data(), original.size(), isNewLine, site);
+            }
+            // 免拷贝入口：msg 只在调用期间被读取。isNewLine 无默认值，避免 log(..., "text", false) 误匹配到本重载
+            void log(const char* file_short, const char* file_full, const char* func, int line,
+                     Level lv, const char* msg, size_t n, bool isNewLine)
+            {
+                logAt_(file_short, file_full, func, line, lv, msg, n, isNewLine, nullptr);
+            }
+            void log(const CallSite* site, Level lv, const char* msg, size_t n, bool isNewLine)
+            {
+                logAt_(site->file_short, site->file_full, site->func, site->line, lv, msg, n, isNewLine, site);
+            }
+            // 带结构化字段：fields 为 ML_ArgCodec 编码的键、值交替序列（见 LoggerStream::kv），只在调用期间被读取。
+            // 文本输出时以 logfmt 附在正文后；二进制文件格式保留类型化编码
+            void log(const char* file_short, const char* file_full, const char* func, int line,
+                     Level lv, const char* msg, size_t n, bool isNewLine, const char* fields, size_t fields_n)
+            {
+                logAt_(file_short, file_full, func, line, lv, msg, n, isNewLine, nullptr, fields, fields_n);
+            }
+            void log(const CallSite* site, Level lv, const char* msg, size_t n, bool isNewLine, const char* fields, size_t fields_n)
+            {
+                logAt_(site->file_short, site->file_full, site->func, site->line, lv, msg, n, isNewLine, site, fields, fields_n);
+            }
+
+            void logformat(const char* file_short, const char* file_full, const char* func, int line,
+                           Level lv, const char* fmt, ...)
+            {
+                if (!_log_enabled || lv < _logLevel)
+                    return;
+                char sbuf[1024];
+                size_t n = 0;
+                va_list args;
+                va_start(args, fmt);
+                const char* s = vformatTo_(sbuf, sizeof(sbuf), n, fmt, args);
+                va_end(args);
+                logAt_(file_short, file_full, func, line, lv, s, n, _add_newline, nullptr);
+                if (s != sbuf)
+                    trimFormatBuf_();
+            }
+            void logformat(const CallSite* site, Level lv, const char* fmt, ...)
+            {
+                if (!_log_enabled || lv < _logLevel)
+                    return;
+                char sbuf[1024];
+                size_t n = 0;
+                va_list args;
+                va_start(args, fmt);
+                const char* s = vformatTo_(sbuf, sizeof(sbuf), n, fmt, args);
+                va_end(args);
+                logAt_(site->file_short, site->file_full, site->func, site->line, lv, s, n, _add_newline, site);
+                if (s != sbuf)
+                    trimFormatBuf_();
+            }
+
+            // 延迟格式化入口（LoggerStream 在 getDeferredFormat() 为 true 时使用）：args 为 ML_ArgCodec 编码。
+            // 异步 + Full 阶段时调用线程只拷贝编码与调用点信息；否则就地渲染后走 log()。
+            // file_short/file_full/func 须为静态存储（宏传入的 __FILE__/__func__ 即是）。
+            void logDeferred(const char* file_short, const char* file_full, const char* func, int line,
+                             Level lv, const char* args, size_t n, bool isNewLine = true)
+            {
+                logDeferredAt_(file_short, file_full, func, line, lv, args, n, isNewLine, nullptr);
+            }
+            void logDeferred(const CallSite* site, Level lv, const char* args, size_t n, bool isNewLine = true)
+            {
+                logDeferredAt_(site->file_short, site->file_full, site->func, site->line, lv, args, n, isNewLine, site);
+            }
+            void logDeferred(const char* file_short, const char* file_full, const char* func, int line,
+                             Level lv, const char* args, size_t n, bool isNewLine, const char* fields, size_t fields_n)
+            {
+                logDeferredAt_(file_short, file_full, func, line, lv, args, n, isNewLine, nullptr, fields, fields_n);
+            }
+            void logDeferred(const CallSite* site, Level lv, const char* args, size_t n, bool isNewLine, const char* fields, size_t fields_n)
+            {
+                logDeferredAt_(site->file_short, site->file_full, site->func, site->line, lv, args, n, isNewLine, site, fields, fields_n);
+            }
+
+            // 开启后（且处于异步模式）LoggerStream 只在调用线程编码参数，文本渲染与前缀/Pattern 格式化在写线程完成。
+            // 二进制文件格式下总是编码参数：参数编码原样写入文件，由解码工具渲染
+            void setDeferredFormat(bool on) { _deferred_format.store(on, std::memory_order_relaxed); }
+            bool getDeferredFormat() const
+            {
+                if (_outputToFile && _file_format.load(std::memory_order_relaxed) == (int)FileFormat::Binary)
+                    return true;
+                return _deferred_format.load(std::memory_order_relaxed) && _async_on.load(std::memory_order_relaxed);
+            }
+
+            // 切换文件格式；格式变化时关闭当前文件，下一条日志滚动到新文件（文本 .log / 二进制 .mlb）
+            void setFileFormat(FileFormat f)
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                if (_file_format.exchange((int)f, std::memory_order_relaxed) == (int)f)
+                    return;
+                if (_file.is_open())
+                    _file.close();
+                _initialized = false;
+            }
+            FileFormat getFileFormat() const { return (FileFormat)_file_format.load(std::memory_order_relaxed); }
+            // 内存映射输出（POSIX）：每个分段按 setLogFile 的 maxSizeInBytes 预先扩展并 mmap，写入只 memcpy 进映射，
+            // 不再有 write 系统调用；进程崩溃时已写内容仍由页缓存落盘。分段打开期间文件长度为预分配大小（尾部为零），
+            // 滚动/关闭时截回实际长度。Windows 或映射失败时照常写入。Linux 以 posix_fallocate 占住真实块（磁盘满时退回 write）。
+            // 崩溃残留的零尾在下次打开文本分段时截去。不兼容外部截短（logrotate copytruncate）：映射写入会触发 SIGBUS，
+            // 需要兼容时另行开启 setFileMmapSigbusGuard
+            void setFileMmap(bool on)
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                if (_file_mmap == on)
+                    return;
+                _file_mmap = on;
+                _file.set_mmap(on ? _maxSizeInBytes : 0);
+                if (_file.is_open())
+                    _file.close();
+                _initialized = false;
+            }
+            bool getFileMmap() const { return _file_mmap; }
+            // 映射写入的 SIGBUS 防护（POSIX，默认关）：开启时进程内安装一次 SIGBUS 处理器（SA_SIGINFO|SA_NODEFER，
+            // 不属于映射写入的 SIGBUS 转交之前安装的处理器），文件被外部截短时放弃映射转为 write 续写。
+            // 应在应用安装自己的 SIGBUS 处理器之后调用，否则会被其取代
+            void setFileMmapSigbusGuard(bool on)
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                _file_sigbus = on;
+                _file.set_sigbus_guard(on);
+            }
+            bool getFileMmapSigbusGuard() const { return _file_sigbus; }
+            // io_uring 输出（Linux，需以 MLLOG_IO_URING=1 构建）：缓冲写满或 flush 时提交异步写并换到空闲的登记缓冲继续填充，
+            // 不等待完成（至多两批在途，完成项延后回收；关闭分段时等齐）；不足 4KB 的小批直接 pwrite。
+            // 批次提交（setGroupCommit 的 fsyncPerBatch）在写后追加一个 IO_DRAIN 的 fdatasync 并等待其完成。
+            // 与 setFileMmap 同时开启时以 mmap 为准；未编入或内核不支持时照常 write
+            void setFileIoUring(bool on)
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                if (_file_uring == on)
+                    return;
+                _file_uring = on;
+                _file.set_uring(on);
+                if (_file.is_open())
+                    _file.close();
+                _initialized = false;
+            }
+            bool getFileIoUring() const { return _file_uring; }
+            // 分段预分配（Linux）：打开分段时以 fallocate(FALLOC_FL_KEEP_SIZE) 预留到 maxSizeInBytes，稳态追加不再
+            // 逐次分配区段、更新日志元数据；writebackBytes > 0 时每写出这么多字节用 sync_file_range 发起一次异步回写，
+            // 让脏页平稳下盘，而不是积到内核阈值后集中刷出造成写延迟尖峰。文件长度不变，关闭分段时释放未用部分
+            void setFilePreallocate(bool on, size_t writebackBytes = 0)
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                if (_file_prealloc == on && _file_writeback == writebackBytes)
+                    return;
+                _file_prealloc = on;
+                _file_writeback = writebackBytes;
+                _file.set_prealloc(on ? _maxSizeInBytes : 0, on ? writebackBytes : 0);
+                if (_file.is_open())
+                    _file.close();
+                _initialized = false;
+            }
+            bool getFilePreallocate() const { return _file_prealloc; }
+            // 后台滚动：当前分段写到 3/4 时由后台线程（ML_FileRoller）建目录并预开下一分段，写满时只交换流对象；
+            // 换下的旧分段在后台写出缓冲并关闭（组提交 fsyncPerBatch 时先 fdatasync）。写线程/调用线程不再在
+            // mkdir/open/close 上等待；写满时预开尚未完成则不等待，照常同步打开。flush() 会等待后台写完旧分段。预开从不截断已有分段：绕回时写入临时文件 <分段>.next，
+            // 交换时 rename 覆盖最旧分段（Windows 上绕回照常同步滚动）。maxRolls 为 1（下一段即当前文件）时照常同步滚动
+            void setBackgroundRoll(bool on)
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                if (on && !_next_seg)
+                    _next_seg = std::make_shared<NextSegment_>();
+                if (!on && _next_seg)
+                {
+                    dropPrepared_UnsafeLocked_();
+                    std::lock_guard<std::mutex> slk(_next_seg->m);
+                    _next_seg->spare.reset();
+                }
+                _bg_roll = on;
+                _next_requested = false;
+            }
+            bool getBackgroundRoll() const { return _bg_roll; }
+
+            // 把二进制日志渲染为文本：pattern 为空时沿用文件中记录的 pattern / 默认前缀（与文本格式输出一致）。
+            // 文件按写入端的本机字节序存放，须在同构平台上解码；格式不符或记录截断时返回 false（已解码部分照常输出）
+            static bool decodeBinaryLog(std::istream& in, std::ostream& out, const std::string& pattern = std::string());
+
+        private:
+            void logAt_(const char* file_short, const char* file_full, const char* func, int line,
+                        Level lv, const char* text, size_t text_n, bool isNewLine, const CallSite* site,
+                        const char* kv = nullptr, size_t kv_n = 0)
+            {
+                if (!_log_enabled || lv < _logLevel)
+                    return;
+
+                const auto now = std::chrono::system_clock::now();
+                int ms_count = 0;
+                std::tm cached_tm{};
+                const char* time_c = nullptr;
+                updateAndGetTimeCache_(now, cached_tm, ms_count, time_c);
+
+                // 仅超长时才复制出截断副本；常规路径直接引用调用方的缓冲
+                std::string truncated;
+                const char* msg = text;
+                size_t msg_n = text_n;
+                if (text_n > MAX_LOG_MESSAGE_SIZE)
+                {
+                    truncated.assign(text, MAX_LOG_MESSAGE_SIZE);
+                    truncated.append(TRUNCATED_MESSAGE);
+                    msg = truncated.data();
+                    msg_n = truncated.size();
+                }
+                // 计算有效结尾（零分配）
+                size_t end = msg_n;
+                while (end > 0)
+                {
+                    char c = msg[end - 1];
+                    if (c == '\n' || c == '\r')
+                        --end;
+                    else
                         break;
-                    case 'e': // 毫秒
-                        if (!datechunk.empty())
+                }
+                bool needNewLine = isNewLine && (end == msg_n); // 仅当原文末尾本就没有换行时才补
+                // 结构化字段：文本输出时按 logfmt 并入正文（位于结尾换行之前）；原始记录路径与 sink 保留编码
+                const bool json = _json_lines.load(std::memory_order_relaxed);
+                const bool sinks = _has_sinks.load(std::memory_order_acquire);
+                const bool raw_full = phase() == Phase::Full && (binaryFile_() || sinks);
+                if (kv_n > 0 && !json && !raw_full && !sinks)
+                {
+                    thread_local std::string with_fields;
+                    with_fields.assign(msg, end);
+                    ML_ArgCodec::render_fields(kv, kv_n, with_fields);
+                    const size_t tail = msg_n - end;
+                    with_fields.append(msg + end, tail);
+                    msg = with_fields.data();
+                    msg_n = with_fields.size();
+                    end = msg_n - tail;
+                    kv_n = 0;
+                }
+                // -------------------------------------------------------------------
+                // Light 阶段：上屏 + 入 pending
+                if (phase() != Phase::Full)
+                {
+                    if (sinks)
+                    {
+                        logLightWithSinks_(now, lv, file_short, file_full, func, line, msg, msg_n, needNewLine, kv, kv_n);
+                        tryAutoPromoteToFull_NoThrow_();
+                        return;
+                    }
+                    std::string linebuf;
+                    if (json)
+                    {
+                        renderJson_(cached_tm, ms_count, lv, file_short, line, msg, msg_n, kv, kv_n, linebuf);
+                    }
+                    else if (!_message_only)
+                    {
+                        if (const CompiledPattern_* pat = _pattern.load(std::memory_order_acquire))
                         {
-                            datechunk += "%e";
+                            renderPattern_(*pat, cached_tm, ms_count, lv, file_short, file_full, func, line, msg, msg_n, linebuf);
                         }
                         else
                         {
-                            flush_lit();
-                            out.push_back({PatType::Ms, {}});
-                        }
-                        break;
-                    default:
-                        if (datechunk.empty())
-                            flush_lit();
-                        datechunk.push_back('%');
-                        datechunk.push_back(c);
-                        if (!is_time_spec_char_(c))
-                        {
+                            char prefix[192];
+                            int plen = buildPrefix_(prefix, sizeof(prefix), lv, file_short, line, time_c, ms_count);
+                            if (plen > 0)
+                                linebuf.append(prefix, (size_t)plen);
+                            linebuf.append(msg, end);
                         }
-                        break;
                     }
+                    else
+                    {
+                        linebuf.append(msg, end);
+                    }
+                    if (needNewLine && !json)
+                        linebuf.push_back('\n');
+
+                    {
+                        std::lock_guard<std::mutex> lk(_mutex);
+                        if (_outputToScreen)
+                            writeToScreen_(linebuf, false, lv);
+                        enqueuePendingLine_NoIO_UnsafeLocked_(std::move(linebuf));
+                    }
+
+                    tryAutoPromoteToFull_NoThrow_();
+                    return;
                 }
-                flush_date();
-                flush_lit();
-                return !out.empty();
+
+                // 二进制文件格式或挂有 sink：调用线程不渲染，正文原样交给写出端（编码、按各目标的行格式渲染）
+                if (raw_full)
+                {
+                    AsyncMeta_ m;
+                    m.ts_ns = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+                    m.file_short = file_short;
+                    m.file_full = file_full;
+                    m.func = func;
+                    m.line = line;
+                    m.site = site;
+                    m.tid = current_tid_();
+                    m.lv = lv;
+                    m.newline = needNewLine;
+                    m.deferred = false;
+                    m.raw = true;
+                    m.kv_len = (uint32_t)kv_n;
+                    size_t payload_n = msg_n;
+                    const char* payload = joinFields_(msg, payload_n, kv, kv_n);
+                    if (!_async_on.load(std::memory_order_acquire) || !asyncEnqueue_(m, payload, payload_n))
+                        writeRecordNow_(m, payload, payload_n);
+                    return;
+                }
+
+                // Full 阶段
+                auto& formatted = tls_buf_();
+                if (json)
+                {
+                    renderJson_(cached_tm, ms_count, lv, file_short, line, msg, msg_n, kv, kv_n, formatted);
+                }
+                else if (_message_only)
+                {
+                    formatted.assign(msg, msg_n);
+                }
+                else if (const CompiledPattern_* pat = _pattern.load(std::memory_order_acquire))
+                {
+                    // 已编译的 pattern 不可变、替换后旧对象仍保留，无需持锁
+                    renderPattern_(*pat, cached_tm, ms_count, lv, file_short, file_full, func, line, msg, msg_n, formatted);
+                }
+                else
+                {
+                    formatMessageFast_DefaultPrefix_(lv, file_short, line, time_c, ms_count, msg, msg_n, formatted);
+                }
+                if (_async_on.load(std::memory_order_acquire))
+                {
+                    AsyncMeta_ m;
+                    m.ts_ns = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+                    m.file_short = file_short;
+                    m.file_full = file_full;
+                    m.func = func;
+                    m.line = line;
+                    m.site = site;
+                    m.tid = 0;
+                    m.lv = lv;
+                    m.newline = needNewLine && !json;
+                    m.deferred = false;
+                    m.raw = false;
+                    m.kv_len = 0;
+                    if (asyncEnqueue_(m, formatted.data(), formatted.size()))
+                        return;
+                }
+                writeToTargets_(formatted, needNewLine && !json, lv);
+            }
+
+            // Light 阶段挂有 sink：整行照常上屏并入 pending，sink 立即收到（sink 不受“Light 不上盘”约束）
+            void logLightWithSinks_(const std::chrono::system_clock::time_point& now, Level lv, const char* file_short,
+                                    const char* file_full, const char* func, int line, const char* msg, size_t msg_n,
+                                    bool needNewLine, const char* kv, size_t kv_n)
+            {
+                const long long ts = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+                const std::string body(msg, msg_n);
+                std::string linebuf;
+                {
+                    std::lock_guard<std::mutex> lk(_mutex);
+                    RecordCtx_ c;
+                    makeRecordCtx_(c, ts, lv, file_short, file_full, func, line, current_tid_(), 0, body, kv, kv_n);
+                    const bool terminated = renderLine_(SinkFormat::Inherit, nullptr, c, linebuf);
+                    prepareSinks_UnsafeLocked_(c, needNewLine, &linebuf);
+                    if (needNewLine && !terminated)
+                        linebuf.push_back('\n');
+                    if (_outputToScreen)
+                        writeToScreen_(linebuf, false, lv);
+                    enqueuePendingLine_NoIO_UnsafeLocked_(std::move(linebuf));
+                }
+                deliverSinks_();
+            }
+
+            // 先格式化到调用方的栈缓冲；放不下时落到线程私有的堆缓冲（容量保留复用，用完后由 trimFormatBuf_ 收缩）。
+            // 返回文本指针，长度写入 n。格式串本身有误（编码错误等）时原样输出格式串。
+            static const char* vformatTo_(char* sbuf, size_t cap, size_t& n, const char* fmt, va_list args)
+            {
+                va_list cpy;
+                va_copy(cpy, args);
+#if defined(_WIN32)
+                int need = _vsnprintf(sbuf, cap, fmt, cpy); // 截断时返回 -1
+                va_end(cpy);
+                if (need >= 0 && (size_t)need < cap)
+                {
+                    n = (size_t)need;
+                    return sbuf;
+                }
+                va_copy(cpy, args);
+                need = _vscprintf(fmt, cpy);
+                va_end(cpy);
+#else
+                int need = vsnprintf(sbuf, cap, fmt, cpy);
+                va_end(cpy);
+                if (need >= 0 && (size_t)need < cap)
+                {
+                    n = (size_t)need;
+                    return sbuf;
+                }
+#endif
+                if (need < 0)
+                {
+                    n = std::strlen(fmt);
+                    return fmt;
+                }
+                std::string& big = format_big_buf_();
+                big.resize((size_t)need + 1);
+                va_copy(cpy, args);
+#if defined(_WIN32)
+                _vsnprintf(&big[0], big.size(), fmt, cpy);
+#else
+                vsnprintf(&big[0], big.size(), fmt, cpy);
+#endif
+                va_end(cpy);
+                n = (size_t)need;
+                return big.data();
+            }
+
+            static std::string& format_big_buf_()
+            {
+                thread_local std::string big;
+                return big;
+            }
+            // 超长消息撑大的线程私有格式化缓冲不长期驻留：超过 FORMAT_BUF_SHRINK 时释放，常规大小的容量保留复用
+            static void trimFormatBuf_()
+            {
+                std::string& big = format_big_buf_();
+                if (big.capacity() > FORMAT_BUF_SHRINK)
+                    std::string().swap(big);
+            }
+
+            void logDeferredAt_(const char* file_short, const char* file_full, const char* func, int line,
+                                Level lv, const char* args, size_t n, bool isNewLine, const CallSite* site,
+                                const char* kv = nullptr, size_t kv_n = 0)
+            {
+                if (!_log_enabled || lv < _logLevel)
+                    return;
+                if (phase() == Phase::Full && (_async_on.load(std::memory_order_acquire) || rawRecords_()))
+                {
+                    AsyncMeta_ m;
+                    m.ts_ns = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::system_clock::now().time_since_epoch())
+                                  .count();
+                    m.file_short = file_short;
+                    m.file_full = file_full;
+                    m.func = func;
+                    m.line = line;
+                    m.site = site;
+                    m.tid = current_tid_();
+                    m.lv = lv;
+                    m.newline = isNewLine;
+                    m.deferred = true;
+                    m.raw = false;
+                    m.kv_len = (uint32_t)kv_n;
+                    size_t payload_n = n;
+                    const char* payload = joinFields_(args, payload_n, kv, kv_n);
+                    if (_async_on.load(std::memory_order_acquire) && asyncEnqueue_(m, payload, payload_n))
+                        return;
+                    if (rawRecords_())
+                    {
+                        writeRecordNow_(m, payload, payload_n);
+                        return;
+                    }
+                }
+                std::string msg;
+                ML_ArgCodec::render(args, n, msg);
+                logAt_(file_short, file_full, func, line, lv, msg.data(), msg.size(), isNewLine, site, kv, kv_n);
+            }
+
+            // 入队/编码的正文为“消息或参数编码 + 字段编码”连续字节；调用方（LoggerStream）已连续存放时不复制。n 返回总长度
+            static const char* joinFields_(const char* body, size_t& n, const char* kv, size_t kv_n)
+            {
+                if (kv_n == 0 || kv == body + n)
+                {
+                    n += kv_n;
+                    return body;
+                }
+                thread_local std::string joined;
+                joined.assign(body, n);
+                joined.append(kv, kv_n);
+                n = joined.size();
+                return joined.data();
+            }
+
+        public:
+            // 工具：路径/进程名
+            static std::string get_module_path() { return platform_getModulePath_(); }
+            static std::string get_module_basename() { return platform_getModuleBasename_(); }
+            static std::string process_name() { return platform_getProcessName_(); }
+            ML_DEPRECATED("Use ML_Logger::process_name() (static) instead")
+            std::string get_process_name() const { return ML_Logger::process_name(); }
+
+            // 清理旧日志
+            void cleanupOldLogs(int daysToKeep = 5)
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                if (!_outputToFile)
+                    return;
+
+                size_t p = _baseName.find_last_of("\\/");
+                std::string dir = (p != std::string::npos) ? _baseName.substr(0, p + 1) : platform_currentDirWithSlash_();
+                std::string stem = (p != std::string::npos) ? _baseName.substr(p + 1) : _baseName;
+
+                std::vector<std::string> files = platform_listLogFiles_(dir, stem);
+                for (const auto& name : files)
+                    if (shouldDeleteLog_(name, daysToKeep))
+                        platform_deleteFile_(dir + name);
+            }
+
+            // --------- Pattern API（新增）---------
+            // 编译为不可变对象后原子发布；渲染线程无需持锁，被替换的对象保留到 logger 析构。
+            // 与已发布过的某个 pattern 相同时复用该对象，反复切换少数几种格式不会累积
+            void setPattern(const std::string& pattern)
+            {
+                std::unique_ptr<CompiledPattern_> cp(new CompiledPattern_());
+                static std::atomic<unsigned long long> serial{0};
+                cp->raw = pattern;
+                cp->serial = serial.fetch_add(1, std::memory_order_relaxed) + 1;
+                const bool ok = compilePattern_(pattern, cp->ops);
+                for (const auto& op : cp->ops)
+                    if (op.type == PatType::DateChunk)
+                        cp->has_date = true;
+                std::lock_guard<std::mutex> lk(_mutex);
+                _pattern_raw = pattern;
+                if (!ok)
+                {
+                    _pattern.store(nullptr, std::memory_order_release);
+                    return;
+                }
+                for (const auto& old : _patterns)
+                    if (old->raw == pattern)
+                    {
+                        _pattern.store(old.get(), std::memory_order_release);
+                        return;
+                    }
+                _pattern.store(cp.get(), std::memory_order_release);
+                _patterns.push_back(std::move(cp));
+            }
+            std::string getPattern()
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                return _pattern_raw;
+            }
+            // JSON-lines 渲染（与 setPattern 同级的行格式选择，开启后优先于 pattern / message-only）：每行一个对象
+            // {"ts":"2025-01-02T03:04:05.678+08:00","level":"INFO","logger":"default","file":"a.cpp","line":12,"msg":"..."}，
+            // 结构化字段（kv）作为同级成员按类型追加。正文按 JSON 转义（向量化扫描），非法 UTF-8 原样透传
+            // 每个对象独占一行并以单个 '\n' 结束，不受 setAddNewLine 影响；正文结尾的换行保留在 "msg" 内
+            void setJsonLines(bool on) { _json_lines.store(on, std::memory_order_relaxed); }
+            bool getJsonLines() const { return _json_lines.load(std::memory_order_relaxed); }
+
+            // ---------- 附加输出目标（sink）----------
+            // 在内置的文件/屏幕输出之外再挂 sink（见 ML_FileSink / ML_ConsoleSink / ML_CallbackSink / ML_MemorySink /
+            // ML_SocketSink）；每个 sink 有自己的级别下限（仍受 setLogLevel 约束）与行格式。挂有 sink 时记录以原始正文
+            // 交给写出端（异步时为写线程），每种行格式每条记录只渲染一次。Light 阶段的记录在调用线程直接分发
+            void addSink(std::shared_ptr<Sink> sink, Level minLevel = Level::Debug,
+                         const SinkFormat& format = SinkFormat::inherit())
+            {
+                if (!sink)
+                    return;
+                std::unique_ptr<CompiledPattern_> cp;
+                if (format.kind == SinkFormat::Pattern)
+                {
+                    cp.reset(new CompiledPattern_());
+                    cp->raw = format.pattern;
+                    if (!compilePattern_(format.pattern, cp->ops))
+                        cp.reset();
+                }
+                std::lock_guard<std::mutex> lk(_mutex);
+                std::shared_ptr<SinkSet_> next = _sinks ? std::make_shared<SinkSet_>(*_sinks) : std::make_shared<SinkSet_>();
+                size_t slot = 0;
+                while (slot < next->slots.size() &&
+                       !(next->slots[slot]->kind == format.kind && next->slots[slot]->key == format.pattern))
+                    ++slot;
+                if (slot == next->slots.size())
+                {
+                    std::shared_ptr<SinkSlot_> s = std::make_shared<SinkSlot_>();
+                    s->kind = format.kind;
+                    s->key = format.pattern;
+                    s->pat = std::move(cp);
+                    next->slots.push_back(std::move(s));
+                }
+                next->sinks.push_back(SinkEntry_{std::move(sink), minLevel, slot});
+                _sinks = std::move(next);
+                _has_sinks.store(true, std::memory_order_release);
+            }
+            // 移除后不再被任何 sink 使用的行格式 slot 一并释放；sink 对象在解锁后析构（可能等后台线程发完）
+            bool removeSink(const std::shared_ptr<Sink>& sink)
+            {
+                std::shared_ptr<const SinkSet_> old;
+                std::lock_guard<std::mutex> lk(_mutex);
+                if (!_sinks)
+                    return false;
+                std::shared_ptr<SinkSet_> next = std::make_shared<SinkSet_>();
+                std::vector<size_t> remap(_sinks->slots.size(), (size_t)-1);
+                bool found = false;
+                for (const auto& e : _sinks->sinks)
+                {
+                    if (!found && e.sink == sink)
+                    {
+                        found = true;
+                        continue;
+                    }
+                    if (remap[e.slot] == (size_t)-1)
+                    {
+                        remap[e.slot] = next->slots.size();
+                        next->slots.push_back(_sinks->slots[e.slot]);
+                    }
+                    next->sinks.push_back(SinkEntry_{e.sink, e.level, remap[e.slot]});
+                }
+                if (!found)
+                    return false;
+                old.swap(_sinks);
+                if (!next->sinks.empty())
+                    _sinks = std::move(next);
+                _has_sinks.store(_sinks != nullptr, std::memory_order_release);
+                return true;
+            }
+            void clearSinks()
+            {
+                std::shared_ptr<const SinkSet_> old;
+                std::lock_guard<std::mutex> lk(_mutex);
+                old.swap(_sinks);
+                _has_sinks.store(false, std::memory_order_release);
+            }
+            std::string name() const { return _name; }
+
+            void setHealCheckEvery(int n)
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                _heal_every = (n > 0 ? n : 0);
+                _heal_counter = 0;
+            }
+
+        private:
+            /* -------- 运行时状态 & 内部函数（保留原有结构，略去未改动的注释） -------- */
+            friend class ML_FileSink;    // 建目录
+            friend class ML_ConsoleSink; // 控制台锁与级别颜色
+            friend class ML_LoggerRegistry; // flushAtExit_
+            struct CompiledPattern_;
+
+            // 进程退出（Registry 的 atexit 钩子）：写出缓冲；内存映射的分段就此关闭，截去预分配的零尾
+            void flushAtExit_()
+            {
+                flush();
+                std::lock_guard<std::mutex> lk(_mutex);
+                dropPrepared_UnsafeLocked_();
+                // 截去映射零尾 / 释放未用的预分配 / 等在途的 io_uring 写完成（flush 不等待）
+                if (_file.is_mmapped() || _file_prealloc || _file.is_uring())
+                {
+                    _file.close();
+                    _initialized = false;
+                }
+            }
+
+            enum class Phase_AtomicTag
+            {
+            };
+            Phase phase() const { return (Phase)_phase.load(std::memory_order_acquire); }
+            void setPhase_(Phase p) { _phase.store((int)p, std::memory_order_release); }
+
+            void enqueuePendingLine_NoIO_UnsafeLocked_(std::string&& line)
+            {
+                _pending_bytes += line.size();
+                _pending.emplace_back(std::move(line));
+                while (_pending_bytes > PENDING_MAX_BYTES || _pending.size() > PENDING_MAX_COUNT)
+                {
+                    _pending_bytes -= _pending.front().size();
+                    _pending.pop_front();
+                }
+            }
+
+            void enqueueStartBanner_NoIO_UnsafeLocked_()
+            {
+                std::string line;
+                if (!formatInternalLine_UnsafeLocked_(Level::Alert, "---------- Start MLLOG ----------", line) && _add_newline)
+                    line.push_back('\n');
+                enqueuePendingLine_NoIO_UnsafeLocked_(std::move(line));
+            }
+
+            // 库内部合成的日志行（启动横幅、异步丢弃统计等）；调用方持有 _mutex。返回 true 表示行已含结尾换行（JSON-lines）
+            bool formatInternalLine_UnsafeLocked_(Level lv, const std::string& msg, std::string& line)
+            {
+                int ms = 0;
+                std::tm tm{};
+                const char* tc = nullptr;
+                updateAndGetTimeCache_(tm, ms, tc);
+                if (_json_lines.load(std::memory_order_relaxed))
+                {
+                    renderJson_(tm, ms, lv, "mllog.hpp", 0, msg.data(), msg.size(), nullptr, 0, line);
+                    return true;
+                }
+                if (const CompiledPattern_* pat = _pattern.load(std::memory_order_acquire))
+                {
+                    renderPattern_(*pat, tm, ms, lv, "mllog.hpp", "mllog.hpp", "?", 0, msg.data(), msg.size(), line);
+                }
+                else
+                {
+                    char prefix[192];
+                    int plen = buildPrefix_(prefix, sizeof(prefix), lv, "mllog.hpp", 0, tc, ms);
+                    if (plen > 0)
+                        line.append(prefix, (size_t)plen);
+                    line.append(msg);
+                }
+                return false;
+            }
+
+            void tryAutoPromoteToFull_NoThrow_()
+            {
+                if (phase() != Phase::Light)
+                    return;
+                std::lock_guard<std::mutex> lk(_mutex);
+                if (phase() != Phase::Light)
+                    return;
+
+                if (!_outputToFile)
+                {
+                    setPhase_(Phase::Full);
+                    _pending_bytes = 0;
+                    _pending.clear();
+                    return;
+                }
+                if (!_initialized || !_file.is_open())
+                {
+                    rollFiles_();
+                    _initialized = true;
+                }
+                if (!_file.is_open())
+                    return;
+
+                for (const auto& line : _pending)
+                {
+                    const std::string& chunk = fileChunk_(line);
+                    const size_t sz = chunk.size();
+                    if (_currentSize > 0 && (_currentSize + sz > _maxSizeInBytes))
+                        rollFiles_();
+                    _file.write(chunk.data(), sz);
+                    if (_auto_flush)
+                        _file.flush();
+                    if (_file.bad())
+                    {
+                        _file.close();
+                        _initialized = false;
+                        return;
+                    }
+                    _currentSize += sz;
+                    if (_currentSize >= _maxSizeInBytes)
+                        rollFiles_();
+                }
+                _pending_bytes = 0;
+                _pending.clear();
+                setPhase_(Phase::Full);
+            }
+
+            void updateAndGetTimeCache_(std::tm& out_tm, int& out_ms, const char*& out_time_c)
+            {
+                updateAndGetTimeCache_(std::chrono::system_clock::now(), out_tm, out_ms, out_time_c);
+            }
+
+            void updateAndGetTimeCache_(std::chrono::system_clock::time_point now,
+                                        std::tm& out_tm, int& out_ms, const char*& out_time_c)
+            {
+                using clock = std::chrono::system_clock;
+                auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % std::chrono::seconds(1);
+                out_ms = (int)ms.count();
+                const std::time_t t = clock::to_time_t(now);
+                struct TLS
+                {
+                    std::time_t sec;
+                    std::tm tm;
+                    char time_buf[32];
+                    TLS() : sec((time_t)-1), tm{} { time_buf[0] = '\0'; }
+                };
+                thread_local TLS tls;
+                if (t != tls.sec)
+                {
+                    tls.sec = t;
+#if defined(_WIN32)
+                    localtime_s(&tls.tm, &t);
+#else
+                    localtime_r(&t, &tls.tm);
+#endif
+                    std::strftime(tls.time_buf, sizeof(tls.time_buf), "%Y-%m-%d %H:%M:%S", &tls.tm);
+                    if (_isCheckDay)
+                    {
+                        const int ymd = (tls.tm.tm_year + 1900) * 10000 + (tls.tm.tm_mon + 1) * 100 + tls.tm.tm_mday;
+                        int last = _last_log_ymd.load(std::memory_order_relaxed);
+                        if (last == 0)
+                            _last_log_ymd.store(ymd, std::memory_order_relaxed);
+                        else if (last != ymd)
+                        {
+                            _need_day_switch.store(true, std::memory_order_relaxed);
+                            _last_log_ymd.store(ymd, std::memory_order_relaxed);
+                        }
+                    }
+                }
+                out_tm = tls.tm;
+                out_time_c = tls.time_buf;
+            }
+
+            // 等价于 "%s.%03d %s [%s:%d] "，手工拼接；超出 cap 时截断，返回实际写入长度
+            static int buildPrefix_(char* buf, size_t cap, Level lv, const char* file_short, int line, const char* time_c, int ms)
+            {
+                if (cap == 0)
+                    return 0;
+                char* p = buf;
+                char* const lim = buf + cap - 1;
+                auto put = [&](const char* s, size_t n)
+                {
+                    const size_t room = (size_t)(lim - p);
+                    if (n > room)
+                        n = room;
+                    std::memcpy(p, s, n);
+                    p += n;
+                };
+                put(time_c, std::strlen(time_c));
+                const char msb[5] = {'.', (char)('0' + ms / 100 % 10), (char)('0' + ms / 10 % 10), (char)('0' + ms % 10), ' '};
+                put(msb, sizeof(msb));
+                const char* ls = levelToStringC_(lv);
+                put(ls, std::strlen(ls));
+                put(" [", 2);
+                const char* fs = file_short ? file_short : "?";
+                put(fs, std::strlen(fs));
+                char num[24];
+                char* nb = ml_format_i64(num + sizeof(num) - 3, line);
+                num[sizeof(num) - 3] = ']';
+                num[sizeof(num) - 2] = ' ';
+                *--nb = ':';
+                put(nb, (size_t)(num + sizeof(num) - 1 - nb));
+                *p = '\0';
+                return (int)(p - buf);
+            }
+
+            // %t 使用的线程号（std::thread::id 的散列）；延迟格式化时由调用线程采集
+            static unsigned current_tid_() { return (unsigned)std::hash<std::thread::id>{}(std::this_thread::get_id()); }
+
+            static std::string& tls_buf_()
+            {
+                thread_local std::string buf;
+                if (buf.capacity() < 256)
+                    buf.reserve(256);
+                buf.clear();
+                return buf;
+            }
+
+            static const char* levelToStringC_(Level lv)
+            {
+                switch (lv)
+                {
+                case Level::Debug:
+                    return "DEBUG";
+                case Level::Info:
+                    return "INFO";
+                case Level::Notice:
+                    return "NOTICE";
+                case Level::Warning:
+                    return "WARNING";
+                case Level::Error:
+                    return "ERROR";
+                case Level::Critical:
+                    return "CRITICAL";
+                case Level::Alert:
+                    return "ALERT";
+                default:
+                    return "";
+                }
+            }
+
+            // 默认前缀路径（未设置 pattern 时）
+            void formatMessageFast_DefaultPrefix_(Level lv, const char* file_short, int line,
+                                                  const char* time_c, int ms_count,
+                                                  const char* msg, size_t msg_n, std::string& out) const
+            {
+                char prefix[192];
+                int plen = buildPrefix_(prefix, sizeof(prefix), lv, file_short, line, time_c, ms_count);
+                if (plen < 0)
+                {
+                    out.assign(msg, msg_n);
+                    return;
+                }
+                out.reserve((size_t)plen + msg_n);
+                out.append(prefix, (size_t)plen);
+                out.append(msg, msg_n);
+            }
+
+            void writeToTargets_(const std::string& formatted, bool isNewLine, Level lv)
+            {
+                struct InLogGuard
+                {
+                    InLogGuard() { ML_Logger::in_logging_flag_() = true; }
+                    ~InLogGuard() { ML_Logger::in_logging_flag_() = false; }
+                } guard;
+                std::lock_guard<std::mutex> lk(_mutex);
+                writeToTargetsLocked_(formatted, isNewLine, lv);
+            }
+
+            void writeToTargetsLocked_(const std::string& formatted, bool isNewLine, Level lv)
+            {
+                if (_need_day_switch.exchange(false, std::memory_order_relaxed))
+                    onDayChangeLocked_();
+                if (_outputToFile && !_initialized)
+                {
+                    rollFiles_();
+                    _initialized = true;
+                }
+                if (_outputToFile)
+                    writeToFile_(formatted, isNewLine);
+                if (_outputToScreen)
+                    writeToScreen_(formatted, isNewLine, lv);
+            }
+
+            // ---------- 异步写线程 ----------
+            // 入队记录的元信息（平凡可拷贝，可直接 memcpy 进字节环）
+            struct AsyncMeta_
+            {
+                long long ts_ns;
+                const char* file_short;
+                const char* file_full;
+                const char* func;
+                int line;
+                const CallSite* site; // 宏调用点的静态描述符；旧式接口直接调用时为 nullptr
+                unsigned tid;
+                Level lv;
+                bool newline;
+                bool deferred; // true：正文为 ML_ArgCodec 编码的参数，由写线程渲染
+                bool raw;      // true：正文为未加前缀的消息（二进制文件格式），由写出端编码
+                uint32_t kv_len; // 正文末尾的结构化字段编码字节数（见 LoggerStream::kv）
+            };
+            struct AsyncRecord_
+            {
+                AsyncMeta_ meta;
+                std::string text;
+            };
+            using AsyncRing_ = ML_MpscRing<AsyncRecord_>;
+
+            // PerThread：帧头 + 正文写入线程私有字节环；线程退出时标记 closed，写线程排空后摘除
+            struct ThreadFrame_
+            {
+                AsyncMeta_ meta;
+                uint32_t len;
+            };
+            struct ThreadRing_
+            {
+                explicit ThreadRing_(size_t bytes) : ring(bytes), closed(false) {}
+                ML_SpscByteRing ring;
+                std::atomic<bool> closed;
+            };
+            struct ThreadRingSlot_
+            {
+                unsigned long long logger_uid;
+                unsigned epoch;
+                std::shared_ptr<ThreadRing_> ring;
+            };
+            struct ThreadRingTLS_
+            {
+                std::vector<ThreadRingSlot_> slots;
+                ~ThreadRingTLS_()
+                {
+                    for (auto& s : slots)
+                        if (s.ring)
+                            closeThreadRing_(*s.ring);
+                }
+            };
+            static ThreadRingTLS_& thread_rings_tls_()
+            {
+                thread_local ThreadRingTLS_ tls;
+                return tls;
+            }
+            // 进程内累计关闭的线程环数：写线程见其变化时摘除已排空的环
+            static std::atomic<size_t>& thread_rings_closed_()
+            {
+                static std::atomic<size_t> n{0};
+                return n;
+            }
+            static void closeThreadRing_(ThreadRing_& r)
+            {
+                r.closed.store(true, std::memory_order_release);
+                thread_rings_closed_().fetch_add(1, std::memory_order_release);
+            }
+            static std::atomic<unsigned long long>& next_uid_()
+            {
+                static std::atomic<unsigned long long> n{0};
+                return n;
+            }
+
+            // 取本线程在本实例上的字节环；首次使用（或 setAsync 重启后）登记新环
+            ThreadRing_& threadRing_()
+            {
+                auto& tls = thread_rings_tls_();
+                const unsigned epoch = _async_epoch.load(std::memory_order_acquire);
+                ThreadRingSlot_* slot = nullptr;
+                for (auto& s : tls.slots)
+                    if (s.logger_uid == _uid)
+                    {
+                        if (s.epoch == epoch)
+                            return *s.ring;
+                        closeThreadRing_(*s.ring);
+                        slot = &s;
+                        break;
+                    }
+                if (!slot)
+                {
+                    tls.slots.push_back(ThreadRingSlot_{_uid, 0, nullptr});
+                    slot = &tls.slots.back();
+                }
+                slot->epoch = epoch;
+                slot->ring = std::make_shared<ThreadRing_>(_async_thread_bytes.load(std::memory_order_relaxed));
+                std::lock_guard<std::mutex> lk(_thread_rings_mutex);
+                _thread_rings.push_back(slot->ring);
+                _thread_rings_version.fetch_add(1, std::memory_order_release);
+                return *slot->ring;
+            }
+
+            static bool pushThreadFrame_(ThreadRing_& tr, const AsyncMeta_& m, const char* data, size_t n)
+            {
+                char* p = tr.ring.reserve(sizeof(ThreadFrame_) + n);
+                if (!p)
+                    return false;
+                ThreadFrame_ h;
+                h.meta = m;
+                h.len = (uint32_t)n;
+                std::memcpy(p, &h, sizeof(h));
+                std::memcpy(p + sizeof(h), data, n);
+                tr.ring.commit();
+                return true;
+            }
+
+            // 生产者：拷贝进队列；返回 false 表示应回退为同步写（写线程已停止/自身即写线程）
+            bool asyncEnqueue_(const AsyncMeta_& m, const char* data, size_t n)
+            {
+                if (std::this_thread::get_id() == _async_tid.load(std::memory_order_relaxed))
+                    return false;
+                const unsigned epoch = _async_epoch.load(std::memory_order_acquire);
+                const AsyncOverflow policy = (AsyncOverflow)_async_overflow.load(std::memory_order_relaxed);
+                AsyncRing_* ring = nullptr;
+                ThreadRing_* tr = nullptr;
+                bool oversized = false;
+                if (getAsyncQueue() == AsyncQueue::PerThread)
+                {
+                    tr = &threadRing_();
+                    oversized = sizeof(ThreadFrame_) + n > tr->ring.max_payload(); // 放不进线程环：经溢出缓冲交给写线程
+                }
+                else if (!(ring = _async_ring.load(std::memory_order_acquire)))
+                    return false;
+
+                auto fill = [&](AsyncRecord_& r)
+                {
+                    r.meta = m;
+                    r.text.assign(data, n);
+                };
+                auto still_on = [&]
+                {
+                    return _async_on.load(std::memory_order_acquire) && _async_epoch.load(std::memory_order_acquire) == epoch;
+                };
+                // 溢出缓冲非空期间新记录一律追加到其后（Spill 策略；PerThread 下还有超长记录），写线程在各队列取空后
+                // 才写出溢出缓冲，保证与已入队/已溢出的记录保持先后顺序
+                unsigned spins = 0;
+                unsigned space_gen = _async_space_gen.load(std::memory_order_acquire);
+                if (oversized || (_async_spill_count.load(std::memory_order_acquire) > 0 && (policy == AsyncOverflow::Spill || tr)))
+                {
+                    // 非 Spill 策略不淘汰已溢出的记录：缓冲已满时按策略等写线程写出，或丢弃本条（判满与放入在同一把锁内）
+                    while (!enqueueAsyncSpill_(m, data, n, policy == AsyncOverflow::Spill))
+                    {
+                        if (!still_on())
+                            return false;
+                        if (policy != AsyncOverflow::Block)
+                        {
+                            noteAsyncDropped_();
+                            return true;
+                        }
+                        waitAsyncSpace_(spins, space_gen);
+                    }
+                }
+                else
+                {
+                    while (!(ring ? ring->try_push(fill) : pushThreadFrame_(*tr, m, data, n)))
+                    {
+                        if (!still_on())
+                            return false;
+                        if (policy == AsyncOverflow::DropNewest || (policy == AsyncOverflow::DropOldest && !ring))
+                        {
+                            // SPSC 环只能由写线程消费，PerThread 下 DropOldest 退化为 DropNewest
+                            noteAsyncDropped_();
+                            return true;
+                        }
+                        if (policy == AsyncOverflow::DropOldest)
+                        {
+                            std::lock_guard<std::mutex> ck(_async_consumer_mutex);
+                            if (ring->try_pop([](AsyncRecord_&) {}))
+                            {
+                                noteAsyncDropped_();
+                                _async_done.fetch_add(1, std::memory_order_release);
+                            }
+                            continue;
+                        }
+                        if (policy == AsyncOverflow::Spill)
+                        {
+                            enqueueAsyncSpill_(m, data, n);
+                            break;
+                        }
+                        // Block：唤醒写线程，短暂让出 CPU 后睡眠等待其腾出空位（或异步已被关闭）
+                        waitAsyncSpace_(spins, space_gen);
+                    }
+                }
+                wakeAsyncWriter_();
+                // 复查：若在入队期间异步被关闭/重启，原写线程可能已退出，由本线程就地排空
+                if (!still_on())
+                {
+                    if (ring)
+                        drainAsyncRing_(*ring);
+                    else
+                    {
+                        drainThreadRings_();
+                        drainAsyncSpill_();
+                    }
+                }
+                return true;
+            }
+
+            // 溢出缓冲：沿用 Light 阶段 pending 的“按字节/条数上限淘汰最旧”策略，淘汰计入丢弃数（刚放入的一条不淘汰）。
+            // evict=false 时不淘汰：缓冲已有记录且再放入 n 字节会超出上限则不放入并返回 false
+            bool enqueueAsyncSpill_(const AsyncMeta_& m, const char* data, size_t n, bool evict = true)
+            {
+                std::lock_guard<std::mutex> lk(_async_spill_mutex);
+                if (!evict && !_async_spill.empty() &&
+                    (_async_spill_bytes + n > SPILL_MAX_BYTES || _async_spill.size() >= SPILL_MAX_COUNT))
+                    return false;
+                AsyncRecord_ r;
+                r.meta = m;
+                r.text.assign(data, n);
+                _async_spill_bytes += r.text.size();
+                _async_spill.emplace_back(std::move(r));
+                _async_spill_count.fetch_add(1, std::memory_order_release);
+                while (_async_spill.size() > 1 && (_async_spill_bytes > SPILL_MAX_BYTES || _async_spill.size() > SPILL_MAX_COUNT))
+                {
+                    _async_spill_bytes -= _async_spill.front().text.size();
+                    _async_spill.pop_front();
+                    _async_spill_count.fetch_sub(1, std::memory_order_release);
+                    noteAsyncDropped_();
+                }
+                return true;
+            }
+
+            void noteAsyncDropped_()
+            {
+                _async_dropped.fetch_add(1, std::memory_order_relaxed);
+                _async_dropped_total.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // Block 策略的等待：先让出 CPU 几次，之后在条件变量上睡眠，直到写线程腾出空位（_async_space_gen 变化）。
+            // 写线程递增计数后检查等待者、生产者登记等待者后复查计数（均为 seq_cst），不会漏掉唤醒；超时只为及时复查异步开关
+            void waitAsyncSpace_(unsigned& spins, unsigned& seen_gen)
+            {
+                wakeAsyncWriter_();
+                const unsigned gen = _async_space_gen.load(std::memory_order_acquire);
+                if (gen != seen_gen)
+                {
+                    seen_gen = gen; // 期间已腾出空位：直接重试
+                    return;
+                }
+                if (++spins < 16)
+                {
+                    std::this_thread::yield();
+                    return;
+                }
+                std::unique_lock<std::mutex> lk(_async_space_mutex);
+                _async_space_waiters.fetch_add(1, std::memory_order_seq_cst);
+                _async_space_cv.wait_for(lk, std::chrono::milliseconds(10), [&]
+                                         { return _async_space_gen.load(std::memory_order_seq_cst) != seen_gen; });
+                _async_space_waiters.fetch_sub(1, std::memory_order_relaxed);
+                seen_gen = _async_space_gen.load(std::memory_order_acquire);
+            }
+
+            // 写线程（或就地排空者）腾出了队列/溢出缓冲空间：唤醒 Block 中睡眠的生产者
+            void noteAsyncSpace_()
+            {
+                _async_space_gen.fetch_add(1, std::memory_order_seq_cst);
+                if (_async_space_waiters.load(std::memory_order_seq_cst) > 0)
+                {
+                    std::lock_guard<std::mutex> lk(_async_space_mutex);
+                    _async_space_cv.notify_all();
+                }
+            }
+
+            void wakeAsyncWriter_()
+            {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (_async_idle.load(std::memory_order_relaxed))
+                {
+                    std::lock_guard<std::mutex> lk(_async_wait_mutex);
+                    _async_cv.notify_one();
+                }
+            }
+
+            // 单消费者：取出至多 batch.size() 条；槽内字符串与批次字符串交换，双方容量都得以保留
+            size_t collectAsyncBatch_(AsyncRing_& ring, std::vector<AsyncRecord_>& batch)
+            {
+                std::lock_guard<std::mutex> ck(_async_consumer_mutex);
+                size_t n = 0;
+                while (n < batch.size() && ring.try_pop([&](AsyncRecord_& r)
+                                                        {
+                                                            batch[n].meta = r.meta;
+                                                            batch[n].text.swap(r.text); }))
+                    ++n;
+                if (n > 0)
+                    noteAsyncSpace_(); // 槽位取出即空出，不等本批写完
+                return n;
+            }
+
+            // 写出一条记录；延迟/原始记录在此渲染正文、截断，并按调用时刻/线程号为各目标渲染整行。
+            // 二进制文件格式下文件只收编码后的事件。调用方持有 _mutex
+            void writeAsyncRecord_UnsafeLocked_(const AsyncMeta_& m, const std::string& text)
+            {
+                if (!m.deferred && !m.raw)
+                {
+                    writeToTargetsLocked_(text, m.newline, m.lv);
+                    return;
+                }
+                const bool bin = binaryFile_();
+                if (bin)
+                    writeBinaryEvent_UnsafeLocked_(m, text.data(), text.size());
+                const bool text_targets = bin ? _outputToScreen : (_outputToFile || _outputToScreen);
+                if (!text_targets && !_sinks)
+                    return;
+                std::string& msg = _deferred_msg;
+                const size_t body_n = text.size() - m.kv_len;
+                recordMessage_(text.data(), body_n, m.deferred, msg);
+                size_t end = msg.size();
+                while (end > 0 && (msg[end - 1] == '\n' || msg[end - 1] == '\r'))
+                    --end;
+                const bool needNewLine = m.newline && (end == msg.size());
+                RecordCtx_ c;
+                makeRecordCtx_(c, m.ts_ns, m.lv, m.file_short, m.file_full, m.func, m.line, m.tid, 0, msg,
+                               text.data() + body_n, m.kv_len);
+                const std::string* inherit_line = nullptr;
+                if (text_targets)
+                {
+                    std::string& line = _deferred_line;
+                    line.clear();
+                    const bool nl = !renderLine_(SinkFormat::Inherit, nullptr, c, line) && needNewLine;
+                    if (bin)
+                        writeToScreen_(line, nl, m.lv);
+                    else
+                        writeToTargetsLocked_(line, nl, m.lv);
+                    inherit_line = &line;
+                }
+                prepareSinks_UnsafeLocked_(c, needNewLine, inherit_line);
+            }
+
+            // 一条记录的渲染上下文：时间按调用时刻取自缓存；文本行格式用的“正文 + logfmt 字段”首次需要时生成
+            struct RecordCtx_
+            {
+                long long ts_ns;
+                std::tm tm;
+                int ms;
+                const char* time_c;
+                Level lv;
+                const char* file_short;
+                const char* file_full;
+                const char* func;
+                int line;
+                unsigned tid;
+                unsigned pid;
+                const std::string* msg;
+                const char* kv;
+                size_t kv_n;
+                bool msg_kv_ready;
+            };
+
+            void makeRecordCtx_(RecordCtx_& c, long long ts_ns, Level lv, const char* file_short, const char* file_full,
+                                const char* func, int line, unsigned tid, unsigned pid, const std::string& msg,
+                                const char* kv, size_t kv_n)
+            {
+                const std::chrono::system_clock::time_point tp(
+                    std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(ts_ns)));
+                c.ts_ns = ts_ns;
+                c.tm = std::tm{};
+                c.ms = 0;
+                c.time_c = nullptr;
+                updateAndGetTimeCache_(tp, c.tm, c.ms, c.time_c);
+                c.lv = lv;
+                c.file_short = file_short;
+                c.file_full = file_full;
+                c.func = func;
+                c.line = line;
+                c.tid = tid;
+                c.pid = pid;
+                c.msg = &msg;
+                c.kv = kv;
+                c.kv_n = kv_n;
+                c.msg_kv_ready = false;
+            }
+
+            const std::string& textMessage_(RecordCtx_& c)
+            {
+                if (c.kv_n == 0)
+                    return *c.msg;
+                if (!c.msg_kv_ready)
+                {
+                    _fields_msg = *c.msg;
+                    appendFields_(_fields_msg, c.kv, c.kv_n);
+                    c.msg_kv_ready = true;
+                }
+                return _fields_msg;
+            }
+
+            // 按行格式渲染整行；Inherit 取 logger 当前的 JSON-lines / message-only / pattern / 默认前缀。
+            // 文本格式不含补换行；JSON 对象自带结尾换行，此时返回 true
+            bool renderLine_(SinkFormat::Kind kind, const CompiledPattern_* pat, RecordCtx_& c, std::string& out)
+            {
+                if (kind == SinkFormat::Inherit)
+                {
+                    if (_json_lines.load(std::memory_order_relaxed))
+                        kind = SinkFormat::Json;
+                    else if (_message_only)
+                        kind = SinkFormat::MessageOnly;
+                    else
+                        pat = _pattern.load(std::memory_order_acquire);
+                }
+                if (kind == SinkFormat::Json)
+                {
+                    renderJson_(c.tm, c.ms, c.lv, c.file_short, c.line, c.msg->data(), c.msg->size(), c.kv, c.kv_n, out);
+                    return true;
+                }
+                const std::string& msg = textMessage_(c);
+                if (kind == SinkFormat::MessageOnly)
+                    out.append(msg);
+                else if (pat)
+                    renderPattern_(*pat, c.tm, c.ms, c.lv, c.file_short, c.file_full, c.func, c.line, msg.data(), msg.size(),
+                                   out, c.tid, c.pid);
+                else
+                    formatMessageFast_DefaultPrefix_(c.lv, c.file_short, c.line, c.time_c, c.ms, msg.data(), msg.size(), out);
+                return false;
+            }
+
+            // 备好本条记录的 sink 投递：取 sink 快照，级别达标的 sink 按行格式分组、每组只渲染一次，连同正文/字段
+            // 拷进本线程的待投递队列，由调用方解锁后 deliverSinks_() 发出。inherit_line 为已渲染的 Inherit 行（可空）。
+            // 调用方持有 _mutex
+            void prepareSinks_UnsafeLocked_(RecordCtx_& c, bool needNewLine, const std::string* inherit_line)
+            {
+                if (!_sinks)
+                    return;
+                SinkOutbox_& ob = sink_outbox_();
+                if (ob.n == ob.items.size())
+                    ob.items.emplace_back();
+                SinkDelivery_& d = ob.items[ob.n];
+                const size_t slots = _sinks->slots.size();
+                if (d.lines.size() < slots)
+                    d.lines.resize(slots);
+                d.ready.assign(slots, 0);
+                bool any = false;
+                for (const auto& e : _sinks->sinks)
+                {
+                    if (c.lv < e.level)
+                        continue;
+                    any = true;
+                    if (d.ready[e.slot])
+                        continue;
+                    const SinkSlot_& sl = *_sinks->slots[e.slot];
+                    std::string& line = d.lines[e.slot];
+                    bool terminated;
+                    if (sl.kind == SinkFormat::Inherit && inherit_line)
+                    {
+                        line = *inherit_line;
+                        terminated = _json_lines.load(std::memory_order_relaxed);
+                    }
+                    else
+                    {
+                        line.clear();
+                        terminated = renderLine_(sl.kind, sl.pat.get(), c, line);
+                    }
+                    if (needNewLine && !terminated)
+                        line.push_back('\n');
+                    d.ready[e.slot] = 1;
+                }
+                if (!any)
+                    return;
+                d.owner = this;
+                d.set = _sinks;
+                d.ts_ns = c.ts_ns;
+                d.lv = c.lv;
+                d.file_short = c.file_short;
+                d.file_full = c.file_full;
+                d.func = c.func;
+                d.line = c.line;
+                d.tid = c.tid;
+                d.msg.assign(*c.msg);
+                d.kv.assign(c.kv ? c.kv : "", c.kv_n);
+                ++ob.n;
+            }
+
+            // 发出本线程待投递的 sink 记录；调用方不持有 _mutex，sink 的 I/O 不阻塞其他写日志的线程。
+            // sink 内再写日志时新记录排在队尾，由最外层这次调用一并发出
+            static void deliverSinks_()
+            {
+                SinkOutbox_& ob = sink_outbox_();
+                if (ob.n == 0 || ob.delivering)
+                    return;
+                ob.delivering = true;
+                for (size_t i = 0; i < ob.n; ++i)
+                {
+                    SinkDelivery_& d = ob.items[i]; // deque：嵌套追加不使引用失效
+                    const Record rec{d.ts_ns, d.lv, d.owner->_name.c_str(), d.file_short, d.file_full, d.func, d.line, d.tid,
+                                     d.msg.data(), d.msg.size(), d.kv.data(), d.kv.size()};
+                    for (const auto& e : d.set->sinks)
+                    {
+                        if (d.lv < e.level)
+                            continue;
+                        const std::string& line = d.lines[e.slot];
+                        try
+                        {
+                            e.sink->write(rec, line.data(), line.size());
+                        }
+                        catch (...)
+                        {
+                            d.owner->reportError_("sink write failed");
+                        }
+                    }
+                    d.set.reset();
+                    // 超长消息撑大的缓冲不长期驻留
+                    if (d.msg.capacity() > ASYNC_SLOT_SHRINK)
+                        std::string().swap(d.msg);
+                    for (auto& l : d.lines)
+                        if (l.capacity() > ASYNC_SLOT_SHRINK)
+                            std::string().swap(l);
+                }
+                ob.n = 0;
+                ob.delivering = false;
+            }
+
+            // 记录正文转为消息文本：参数编码在此渲染并截断；raw 正文在调用线程已截断
+            static void recordMessage_(const char* data, size_t n, bool args, std::string& msg)
+            {
+                msg.clear();
+                if (!args)
+                {
+                    msg.assign(data, n);
+                    return;
+                }
+                ML_ArgCodec::render(data, n, msg);
+                if (msg.size() > MAX_LOG_MESSAGE_SIZE)
+                {
+                    msg.resize(MAX_LOG_MESSAGE_SIZE);
+                    msg.append(TRUNCATED_MESSAGE);
+                }
+            }
+
+            // 字段按 logfmt 并入消息，位于结尾换行之前
+            static void appendFields_(std::string& msg, const char* kv, size_t kv_n)
+            {
+                if (kv_n == 0)
+                    return;
+                size_t end = msg.size();
+                while (end > 0 && (msg[end - 1] == '\n' || msg[end - 1] == '\r'))
+                    --end;
+                const std::string tail = msg.substr(end);
+                msg.resize(end);
+                ML_ArgCodec::render_fields(kv, kv_n, msg);
+                msg.append(tail);
+            }
+
+            // 按调用时刻/线程号与当前行格式渲染整行（返回值同 renderLine_）。pid 为 0 时取本进程
+            bool renderRecord_(long long ts_ns, Level lv, const char* file_short, const char* file_full, const char* func,
+                               int line, unsigned tid, const std::string& msg, const char* kv, size_t kv_n, std::string& out,
+                               unsigned pid = 0)
+            {
+                RecordCtx_ c;
+                makeRecordCtx_(c, ts_ns, lv, file_short, file_full, func, line, tid, pid, msg, kv, kv_n);
+                return renderLine_(SinkFormat::Inherit, nullptr, c, out);
+            }
+
+            // 同步写出一条原始/延迟记录（未走异步队列时）
+            void writeRecordNow_(const AsyncMeta_& m, const char* data, size_t n)
+            {
+                struct InLogGuard
+                {
+                    InLogGuard() { ML_Logger::in_logging_flag_() = true; }
+                    ~InLogGuard() { ML_Logger::in_logging_flag_() = false; }
+                } guard;
+                {
+                    std::lock_guard<std::mutex> lk(_mutex);
+                    _sync_record.assign(data, n);
+                    writeAsyncRecord_UnsafeLocked_(m, _sync_record);
+                }
+                deliverSinks_();
+            }
+
+            // 输出待报告的丢弃统计行；调用方持有 _mutex
+            void emitAsyncDropped_UnsafeLocked_()
+            {
+                const size_t dropped = _async_dropped.exchange(0, std::memory_order_relaxed);
+                if (dropped == 0)
+                    return;
+                std::string line;
+                const std::string msg = std::to_string(dropped) + " records dropped (async queue overflow)";
+                const bool terminated = formatInternalLine_UnsafeLocked_(Level::Warning, msg, line);
+                writeToTargetsLocked_(line, !terminated, Level::Warning);
+                if (_sinks)
+                {
+                    RecordCtx_ c;
+                    const long long ts = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                             std::chrono::system_clock::now().time_since_epoch())
+                                             .count();
+                    makeRecordCtx_(c, ts, Level::Warning, "mllog.hpp", "mllog.hpp", "?", 0, 0, 0, msg, nullptr, 0);
+                    prepareSinks_UnsafeLocked_(c, true, nullptr);
+                }
+            }
+
+            template <class Records>
+            void writeAsyncRecords_(Records& recs, size_t n)
+            {
+                struct InLogGuard
+                {
+                    InLogGuard() { ML_Logger::in_logging_flag_() = true; }
+                    ~InLogGuard() { ML_Logger::in_logging_flag_() = false; }
+                } guard;
+                {
+                    std::lock_guard<std::mutex> lk(_mutex);
+                    emitAsyncDropped_UnsafeLocked_();
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        writeAsyncRecord_UnsafeLocked_(recs[i].meta, recs[i].text);
+                        // 超长消息撑大的缓冲不随槽位长期驻留
+                        if (recs[i].text.capacity() > ASYNC_SLOT_SHRINK)
+                        {
+                            std::string t;
+                            t.reserve(ASYNC_SLOT_RESERVE);
+                            recs[i].text.swap(t);
+                        }
+                    }
+                }
+                deliverSinks_(); // 整批的 sink 投递在解锁后发出
+            }
+
+            // PerThread：各线程环头部按时间戳归并，单批至多 ASYNC_BATCH_MAX 条；返回写出条数。
+            // 归并只针对“已发布”的记录，跨线程顺序为尽力而为（同一线程内严格有序）。
+            size_t mergeThreadRings_(std::vector<std::shared_ptr<ThreadRing_>>& rings, std::string& scratch)
+            {
+                struct InLogGuard
+                {
+                    InLogGuard() { ML_Logger::in_logging_flag_() = true; }
+                    ~InLogGuard() { ML_Logger::in_logging_flag_() = false; }
+                } guard;
+                std::lock_guard<std::mutex> ck(_async_consumer_mutex);
+                std::unique_lock<std::mutex> lk(_mutex, std::defer_lock);
+                size_t written = 0;
+                while (written < ASYNC_BATCH_MAX)
+                {
+                    ThreadRing_* best = nullptr;
+                    const char* best_p = nullptr;
+                    ThreadFrame_ best_h;
+                    for (auto& r : rings)
+                    {
+                        size_t n = 0;
+                        const char* p = r->ring.peek(n);
+                        if (!p)
+                            continue;
+                        ThreadFrame_ h;
+                        std::memcpy(&h, p, sizeof(h));
+                        if (!best || h.meta.ts_ns < best_h.meta.ts_ns)
+                        {
+                            best = r.get();
+                            best_p = p;
+                            best_h = h;
+                        }
+                    }
+                    if (!best)
+                        break;
+                    if (!lk.owns_lock())
+                    {
+                        lk.lock();
+                        emitAsyncDropped_UnsafeLocked_();
+                    }
+                    scratch.assign(best_p + sizeof(ThreadFrame_), best_h.len);
+                    writeAsyncRecord_UnsafeLocked_(best_h.meta, scratch);
+                    best->ring.release();
+                    ++written;
+                }
+                if (lk.owns_lock())
+                    lk.unlock();
+                if (written > 0)
+                    noteAsyncSpace_();
+                deliverSinks_();
+                return written;
+            }
+
+            // 同步登记表快照；prune 时顺带摘除已关闭（线程已退出或已换登记）且已排空的线程环，
+            // 快照随版本号更新后最后一个引用释放，环的内存随之归还。返回是否仍有已关闭、尚未排空的环
+            bool refreshThreadRings_(std::vector<std::shared_ptr<ThreadRing_>>& rings, size_t& seen_version, bool prune)
+            {
+                bool lingering = false;
+                if (prune)
+                {
+                    std::lock_guard<std::mutex> ck(_async_consumer_mutex);
+                    std::lock_guard<std::mutex> lk(_thread_rings_mutex);
+                    size_t n = 0;
+                    const size_t before = _thread_rings.size();
+                    for (size_t i = 0; i < _thread_rings.size(); ++i)
+                    {
+                        size_t len = 0;
+                        ThreadRing_& r = *_thread_rings[i];
+                        if (r.closed.load(std::memory_order_acquire))
+                        {
+                            if (!r.ring.peek(len))
+                                continue;
+                            lingering = true;
+                        }
+                        _thread_rings[n++] = _thread_rings[i];
+                    }
+                    _thread_rings.resize(n);
+                    if (n != before)
+                        _thread_rings_version.fetch_add(1, std::memory_order_release);
+                }
+                const size_t v = _thread_rings_version.load(std::memory_order_acquire);
+                if (v == seen_version)
+                    return lingering;
+                std::lock_guard<std::mutex> lk(_thread_rings_mutex);
+                rings = _thread_rings;
+                seen_version = _thread_rings_version.load(std::memory_order_relaxed);
+                return lingering;
+            }
+
+            bool threadRingsEmpty_(std::vector<std::shared_ptr<ThreadRing_>>& rings)
+            {
+                std::lock_guard<std::mutex> ck(_async_consumer_mutex);
+                for (auto& r : rings)
+                {
+                    size_t n = 0;
+                    if (r->ring.peek(n))
+                        return false;
+                }
+                return true;
+            }
+
+            void drainThreadRings_()
+            {
+                std::vector<std::shared_ptr<ThreadRing_>> rings;
+                size_t seen = (size_t)-1;
+                refreshThreadRings_(rings, seen, false);
+                std::string scratch;
+                while (mergeThreadRings_(rings, scratch) > 0)
+                {
+                }
+                refreshThreadRings_(rings, seen, true);
+            }
+
+            // 写出溢出缓冲；写完后才扣减计数，flush() 与生产者据此判断是否仍有未写的溢出记录
+            void drainAsyncSpill_()
+            {
+                if (_async_spill_count.load(std::memory_order_acquire) == 0)
+                    return;
+                std::deque<AsyncRecord_> spilled;
+                {
+                    std::lock_guard<std::mutex> lk(_async_spill_mutex);
+                    spilled.swap(_async_spill);
+                    _async_spill_bytes = 0;
+                }
+                writeAsyncRecords_(spilled, spilled.size());
+                _async_spill_count.fetch_sub(spilled.size(), std::memory_order_release);
+                noteAsyncSpace_();
+            }
+
+            void drainAsyncRing_(AsyncRing_& ring)
+            {
+                std::vector<AsyncRecord_> batch(ASYNC_BATCH_MAX);
+                size_t n;
+                while ((n = collectAsyncBatch_(ring, batch)) > 0)
+                {
+                    writeAsyncRecords_(batch, n);
+                    _async_done.fetch_add(n, std::memory_order_release);
+                }
+                drainAsyncSpill_();
+            }
+
+            void asyncWriterLoop_()
+            {
+                _async_tid.store(std::this_thread::get_id(), std::memory_order_relaxed);
+                const bool per_thread = getAsyncQueue() == AsyncQueue::PerThread;
+                AsyncRing_* ring = _async_ring.load(std::memory_order_acquire);
+                std::vector<AsyncRecord_> batch(per_thread ? 0 : ASYNC_BATCH_MAX);
+                for (auto& r : batch)
+                    r.text.reserve(ASYNC_SLOT_RESERVE);
+                std::vector<std::shared_ptr<ThreadRing_>> rings;
+                size_t seen_version = (size_t)-1;
+                std::string scratch;
+                scratch.reserve(ASYNC_SLOT_RESERVE);
+                size_t seen_closed = (size_t)-1;
+                for (;;)
+                {
+                    size_t n = 0;
+                    if (per_thread)
+                    {
+                        // 有线程环关闭后即摘除（持续有积压时也一样，不只在空闲时）；未排空的下一轮再摘
+                        const size_t closed = thread_rings_closed_().load(std::memory_order_acquire);
+                        const bool prune = closed != seen_closed;
+                        const bool lingering = refreshThreadRings_(rings, seen_version, prune);
+                        if (prune && !lingering)
+                            seen_closed = closed;
+                        n = mergeThreadRings_(rings, scratch);
+                    }
+                    else if ((n = collectAsyncBatch_(*ring, batch)) > 0)
+                    {
+                        writeAsyncRecords_(batch, n);
+                        _async_done.fetch_add(n, std::memory_order_release);
+                    }
+                    if (n > 0)
+                        continue;
+                    if (_async_spill_count.load(std::memory_order_acquire) > 0)
+                    {
+                        drainAsyncSpill_();
+                        continue;
+                    }
+                    if (_async_dropped.load(std::memory_order_relaxed) > 0)
+                        writeAsyncRecords_(batch, 0); // 仅输出丢弃统计行
+                    if (_async_stop.load(std::memory_order_acquire))
+                        break;
+                    if (per_thread)
+                        refreshThreadRings_(rings, seen_version, true);
+                    // 队列已取空：组提交在此结束本批（字节上限/时间窗只在持续有积压、取不空时起作用）
+                    if (_group_commit.load(std::memory_order_relaxed))
+                    {
+                        std::lock_guard<std::mutex> lk(_mutex);
+                        commitGroup_UnsafeLocked_();
+                    }
+                    std::unique_lock<std::mutex> lk(_async_wait_mutex);
+                    _async_idle.store(true, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    bool empty;
+                    if (per_thread)
+                        empty = _thread_rings_version.load(std::memory_order_acquire) == seen_version && threadRingsEmpty_(rings);
+                    else
+                    {
+                        std::lock_guard<std::mutex> ck(_async_consumer_mutex);
+                        empty = ring->empty_approx();
+                    }
+                    empty = empty && _async_spill_count.load(std::memory_order_acquire) == 0;
+                    if (empty && !_async_stop.load(std::memory_order_acquire))
+                        _async_cv.wait_for(lk, std::chrono::milliseconds(100));
+                    _async_idle.store(false, std::memory_order_relaxed);
+                }
+                drainAsyncQueues_();
+                {
+                    std::lock_guard<std::mutex> lk(_mutex);
+                    commitGroup_UnsafeLocked_();
+                }
+                _async_tid.store(std::thread::id(), std::memory_order_relaxed);
+            }
+
+            void drainAsyncQueues_()
+            {
+                AsyncRing_* ring = _async_ring.load(std::memory_order_acquire);
+                if (ring)
+                    drainAsyncRing_(*ring);
+                drainThreadRings_();
+                drainAsyncSpill_();
+            }
+
+            void stopAsyncWriter_()
+            {
+                _async_on.store(false, std::memory_order_release);
+                noteAsyncSpace_(); // Block 中睡眠的生产者复查开关后回退为同步写
+                if (_async_thread.joinable())
+                {
+                    {
+                        std::lock_guard<std::mutex> lk(_async_wait_mutex);
+                        _async_stop.store(true, std::memory_order_release);
+                        _async_cv.notify_one();
+                    }
+                    _async_thread.join();
+                }
+                drainAsyncQueues_();
+            }
+
+            // flush()：等待写线程写完“调用时刻之前”已入队（含溢出缓冲）的记录
+            void waitAsyncDrained_()
+            {
+                if (!_async_on.load(std::memory_order_acquire) || std::this_thread::get_id() == _async_tid.load(std::memory_order_relaxed))
+                    return;
+                AsyncRing_* ring = _async_ring.load(std::memory_order_acquire);
+                const size_t target = ring ? ring->pushed() : 0;
+                // PerThread：记下各线程环此刻的写入位置，等待读取位置越过它
+                std::vector<std::pair<std::shared_ptr<ThreadRing_>, size_t>> marks;
+                {
+                    std::lock_guard<std::mutex> lk(_thread_rings_mutex);
+                    for (auto& r : _thread_rings)
+                        marks.emplace_back(r, r->ring.produced());
+                }
+                auto pending = [&]
+                {
+                    if (_async_base.load(std::memory_order_relaxed) + _async_done.load(std::memory_order_acquire) < target)
+                        return true;
+                    if (_async_spill_count.load(std::memory_order_acquire) > 0)
+                        return true;
+                    for (auto& m : marks)
+                        if (m.first->ring.consumed() < m.second)
+                            return true;
+                    return false;
+                };
+                while (_async_on.load(std::memory_order_acquire) && pending())
+                {
+                    wakeAsyncWriter_();
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                }
+            }
+
+            void writeToFile_(const std::string& s, bool isNewLine)
+            {
+                if (!_outputToFile)
+                    return;
+
+                // NEW: 周期性自愈（POSIX unlink 检测）
+                maybeHealUnlinked_(); // <== 新增
+
+                if (!_file.is_open())
+                {
+                    rollFiles_();
+                    _initialized = true;
+                    if (!_file.is_open())
+                    {
+                        reportError_(std::string("Failed to open file. Message: ") + s);
+                        return;
+                    }
+                }
+
+                const char* data = s.data();
+                size_t n = s.size();
+                if (binaryFile_())
+                {
+                    // 库内部合成的文本行（横幅、丢弃统计、同步文本路径）在二进制文件中存为 'L' 记录
+                    binLineRecord_(data, n, isNewLine, _bin_buf);
+                    data = _bin_buf.data();
+                    n = _bin_buf.size();
+                    isNewLine = false;
+                }
+                const size_t msg_size = n + (isNewLine ? 1u : 0u);
+                if (_currentSize > 0 && (_currentSize + msg_size > _maxSizeInBytes))
+                    rollFiles_();
+                writeFileBytes_(data, n, isNewLine);
+            }
+
+            // 写入一段字节（失败时重开同一路径重试一次），随后按需 flush、累计大小并滚动
+            void writeFileBytes_(const char* data, size_t n, bool isNewLine)
+            {
+                const size_t msg_size = n + (isNewLine ? 1u : 0u);
+
+                // 写入（一次 append）
+                _file.write(data, n);
+                if (isNewLine)
+                    _file.put('\n');
+
+                // NEW: 写失败 → 尝试重开同一路径并重试一次
+                if (_file.bad())
+                {
+                    char nl = '\n';
+
+                    _file.close();
+                    if (_curFilePath.empty())
+                    {
+                        _initialized = false;
+                        reportError_("Log write failed and no current path.");
+                        return;
+                    }
+
+                    _file.open(_curFilePath, std::ios::out | std::ios::app | std::ios::binary);
+                    if (_file.is_open())
+                    {
+                        _file.write(data, n);
+                        if (isNewLine)
+                            _file.put(nl);
+                    }
+
+                    if (_file.bad())
+                    {
+                        reportError_("Log write retry failed.");
+                        _file.close();
+                        _initialized = false; // 让下一次触发 rollFiles_()
+                        return;
+                    }
+                }
+
+                if (_group_commit.load(std::memory_order_relaxed))
+                {
+                    if (_gc_bytes == 0)
+                        _gc_since = std::chrono::steady_clock::now();
+                    _gc_bytes += msg_size;
+                    groupCommitTick_UnsafeLocked_();
+                }
+                else if (_auto_flush)
+                    _file.flush();
+                if (_file.bad())
+                {
+                    reportError_("Log flush failed.");
+                    _file.close();
+                    _initialized = false;
+                    return;
+                }
+
+                _currentSize += msg_size;
+                if (_currentSize >= _maxSizeInBytes)
+                    rollFiles_();
+                else if (_bg_roll && !_next_requested && _currentSize >= _maxSizeInBytes - (_maxSizeInBytes >> 2))
+                    prepareNext_UnsafeLocked_();
+            }
+
+            // 组提交：未提交字节达到上限或最早一条超过时间窗时提交本批；返回距提交还需等待的微秒数（无待提交时为 -1）
+            long long groupCommitTick_UnsafeLocked_()
+            {
+                if (_gc_bytes == 0)
+                    return -1;
+                if (_gc_bytes < _gc_max_bytes)
+                {
+                    const long long age = (long long)std::chrono::duration_cast<std::chrono::microseconds>(
+                                              std::chrono::steady_clock::now() - _gc_since)
+                                              .count();
+                    if (age < (long long)_gc_max_delay_us)
+                        return (long long)_gc_max_delay_us - age;
+                }
+                commitGroup_UnsafeLocked_();
+                return -1;
+            }
+
+            // 提交本批：一次 flush（stream 缓冲整体写出），按设置再 fdatasync/fsync 一次
+            void commitGroup_UnsafeLocked_()
+            {
+                if (_gc_bytes == 0)
+                    return;
+                _gc_bytes = 0;
+                if (!_file.is_open())
+                    return;
+                if (_gc_fsync)
+                    _file.sync();
+                else
+                    _file.flush();
+                if (_file.bad())
+                {
+                    reportError_("Log group commit failed.");
+                    _file.close();
+                    _initialized = false;
+                }
+            }
+
+            // ---------- 二进制文件格式 ----------
+            // 文件头：magic "MLLOGBIN" + u32 版本 + u32 字节序标记 0x01020304 + u8 sizeof(void*)（仅供参考）+ u32 pid + u32 长度 + 实例名
+            // 记录：u8 类型 + var 正文长度 + 正文（未知类型按长度跳过）。定长字段（含文件头）一律小端，参数编码中的指针为 8 字节，
+            // 文件可在任意字节序/字长的平台上解码；版本 1 为本机字节序，仅 64 位小端平台写出的可读（与版本 2 逐字节相同）
+            //   'P' pattern：u8 标志（bit0 message_only，bit1 JSON-lines）+ str pattern（空串为默认前缀）；变化后的首条事件前写出
+            //   'S' 调用点：var id + var line + str file_short + str file_full + str func；每个文件内首次引用前写出
+            //   'E' 事件：i64 ts_ns + u8 level + u8 flags + u32 tid + var 调用点 id + [var 字段长度] + 正文
+            //   'I' 事件（旧式接口，无调用点）：i64 ts_ns + u8 level + u8 flags + u32 tid + var line + 三个 str + [var 字段长度] + 正文
+            //   'L' 文本行：原样字节（库内部合成的行）
+            //   类型字节 0 为填充（内存映射输出异常退出后留下的零尾），解码时跳过
+            // var 为 LEB128 变长整数，str 为 var 长度 + 字节；flags：bit0 补换行，bit1 正文为 ML_ArgCodec 参数编码（否则为消息文本），
+            // bit2 正文末尾带“字段长度”字节的结构化字段编码
+            static constexpr uint32_t BIN_VERSION = 2;
+            static constexpr uint32_t BIN_BYTE_ORDER = 0x01020304u;
+
+            bool binaryFile_() const
+            {
+                return _outputToFile && _file_format.load(std::memory_order_relaxed) == (int)FileFormat::Binary;
+            }
+            // 记录以原始正文交给写出端（由写出端编码/按各目标渲染）
+            bool rawRecords_() const { return binaryFile_() || _has_sinks.load(std::memory_order_acquire); }
+
+            template <class T>
+            static void binPut_(std::string& b, T v)
+            {
+                char tmp[sizeof(T)];
+                ml_store_le(tmp, v);
+                b.append(tmp, sizeof(T));
+            }
+            static size_t binVar_(char* out, unsigned long long v)
+            {
+                size_t n = 0;
+                while (v >= 0x80)
+                {
+                    out[n++] = (char)(v | 0x80);
+                    v >>= 7;
+                }
+                out[n++] = (char)v;
+                return n;
+            }
+            static void binPutVar_(std::string& b, unsigned long long v)
+            {
+                char tmp[10];
+                b.append(tmp, binVar_(tmp, v));
+            }
+            static void binPutStr_(std::string& b, const char* s)
+            {
+                const size_t n = s ? std::strlen(s) : 0u;
+                binPutVar_(b, n);
+                b.append(s ? s : "", n);
+            }
+            // 开始一条记录，返回正文起点；binEnd_ 在正文前插入变长的长度字段
+            static size_t binBegin_(std::string& b, char type)
+            {
+                b.push_back(type);
+                return b.size();
+            }
+            static void binEnd_(std::string& b, size_t body)
+            {
+                char tmp[10];
+                b.insert(body, tmp, binVar_(tmp, b.size() - body));
+            }
+            static void binLineRecord_(const char* s, size_t n, bool isNewLine, std::string& b)
+            {
+                b.clear();
+                const size_t body = binBegin_(b, 'L');
+                b.append(s, n);
+                if (isNewLine)
+                    b.push_back('\n');
+                binEnd_(b, body);
+            }
+
+            // pending 行写入文件时的字节：二进制格式下包成 'L' 记录
+            const std::string& fileChunk_(const std::string& line)
+            {
+                if (!binaryFile_())
+                    return line;
+                binLineRecord_(line.data(), line.size(), false, _bin_buf);
+                return _bin_buf;
+            }
+
+            // 新开（或自愈重开）文件后重置“已写出”状态；二进制格式的空文件先写文件头
+            void onFileOpened_UnsafeLocked_()
+            {
+                _bin_sites.clear();
+                _bin_pattern = 0;
+                if (!binaryFile_() || _currentSize > 0)
+                    return;
+                std::string h("MLLOGBIN", 8);
+                binPut_(h, BIN_VERSION);
+                binPut_(h, BIN_BYTE_ORDER);
+                h.push_back((char)sizeof(void*));
+#if defined(_WIN32)
+                binPut_(h, (uint32_t)GetCurrentProcessId());
+#else
+                binPut_(h, (uint32_t)getpid());
+#endif
+                binPut_(h, (uint32_t)_name.size());
+                h.append(_name);
+                _file.write(h.data(), h.size());
+                _currentSize += h.size();
+            }
+
+            // 编码一条事件写入文件（调用点/pattern 定义按需先行写出）。调用方持有 _mutex
+            void writeBinaryEvent_UnsafeLocked_(const AsyncMeta_& m, const char* data, size_t n)
+            {
+                if (_need_day_switch.exchange(false, std::memory_order_relaxed))
+                    onDayChangeLocked_();
+                maybeHealUnlinked_();
+                if (!_initialized || !_file.is_open())
+                {
+                    rollFiles_();
+                    _initialized = true;
+                    if (!_file.is_open())
+                    {
+                        reportError_("Failed to open binary log file.");
+                        return;
+                    }
+                }
+                // 先按估算长度滚动，使定义记录写进事件所在的文件
+                if (_currentSize > 0 && (_currentSize + n + 64u > _maxSizeInBytes))
+                    rollFiles_();
+
+                std::string& b = _bin_buf;
+                b.clear();
+                const CompiledPattern_* pat = _pattern.load(std::memory_order_acquire);
+                const unsigned long long pkey = pat ? pat->serial + 1 : 1; // 0 表示本文件尚未写出
+                const unsigned char pflags = (unsigned char)((_message_only ? 1 : 0) | (_json_lines.load(std::memory_order_relaxed) ? 2 : 0));
+                if (_bin_pattern != pkey || _bin_pattern_flags != pflags)
+                {
+                    const size_t body = binBegin_(b, 'P');
+                    b.push_back((char)pflags);
+                    binPutStr_(b, pat ? pat->raw.c_str() : "");
+                    binEnd_(b, body);
+                    _bin_pattern = pkey;
+                    _bin_pattern_flags = pflags;
+                }
+                const uint32_t id = m.site ? m.site->id() : 0u;
+                if (m.site && (id >= _bin_sites.size() || !_bin_sites[id]))
+                {
+                    if (id >= _bin_sites.size())
+                        _bin_sites.resize(id + 1, false);
+                    _bin_sites[id] = true;
+                    const size_t body = binBegin_(b, 'S');
+                    binPutVar_(b, id);
+                    binPutVar_(b, (uint32_t)m.site->line);
+                    binPutStr_(b, m.site->file_short);
+                    binPutStr_(b, m.site->file_full);
+                    binPutStr_(b, m.site->func);
+                    binEnd_(b, body);
+                }
+                const size_t body = binBegin_(b, m.site ? 'E' : 'I');
+                binPut_(b, (int64_t)m.ts_ns);
+                b.push_back((char)m.lv);
+                b.push_back((char)((m.newline ? 1 : 0) | (m.deferred ? 2 : 0) | (m.kv_len ? 4 : 0)));
+                binPut_(b, (uint32_t)m.tid);
+                if (m.site)
+                    binPutVar_(b, id);
+                else
+                {
+                    binPutVar_(b, (uint32_t)m.line);
+                    binPutStr_(b, m.file_short);
+                    binPutStr_(b, m.file_full);
+                    binPutStr_(b, m.func);
+                }
+                if (m.kv_len)
+                    binPutVar_(b, m.kv_len);
+                b.append(data, n);
+                binEnd_(b, body);
+                writeFileBytes_(b.data(), b.size(), false);
+            }
+
+            static bool supportsAnsiColor_()
+            {
+                static std::once_flag flag;
+                static bool cached = false;
+                std::call_once(flag, []
+                               {
+#if defined(_WIN32)
+                                   int fd = _fileno(stdout);
+                                   if (fd < 0 || !_isatty(fd))
+                                   {
+                                       cached = false;
+                                       return;
+                                   }
+                                   HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
+                                   DWORD mode = 0;
+                                   if (h && GetConsoleMode(h, &mode) && SetConsoleMode(h, mode | MLLOG_VT_ENABLE))
+                                       cached = true;
+                                   else
+                                       cached = false;
+#else
+                                   cached = ::isatty(STDOUT_FILENO);
+#endif
+                               });
+                return cached;
+            }
+
+            static std::mutex& console_mutex_()
+            {
+                static std::mutex m;
+                return m;
+            }
+
+            void writeToScreen_(const std::string& s, bool isNewLine, Level lv)
+            {
+                const bool colorize = _log_screen_color && supportsAnsiColor_();
+                if (_screen_async.load(std::memory_order_acquire))
+                {
+                    ML_AsyncConsole::out().write(colorize ? levelColorAnsi_(lv) : nullptr, s.data(), s.size(), isNewLine,
+                                                 colorize ? MLLOG_COLOR_RESET : nullptr);
+                    return;
+                }
+                std::lock_guard<std::mutex> g(console_mutex_());
+                if (colorize)
+                    std::cout << levelColorAnsi_(lv);
+                std::cout << s;
+                if (isNewLine)
+                    std::cout << '\n';
+                if (colorize)
+                    std::cout << MLLOG_COLOR_RESET;
+            }
+
+            void onDayChangeLocked_()
+            {
+                dropPrepared_UnsafeLocked_(); // 预开的是旧日期的分段
+                commitGroup_UnsafeLocked_();
+                if (_file.is_open())
+                    _file.close();
+                _initialized = false;
+                _isRoll = false;
+                _currentRollIndex = 0;
+                _currentSize = 0;
+                _start_timestamp = currentTimestamp_();
+                _baseFullNameWithDateAndTime = _baseName + "_" + _start_timestamp;
+                _curFilePath.clear();
+                _heal_counter = 0;
+            }
+
+            void rollFiles_()
+            {
+                if (_baseName.empty())
+                    return;
+                int index = _currentRollIndex + 1;
+                bool wrap = _isRoll;
+                if (index > _maxRolls)
+                {
+                    wrap = true;
+                    index = 1;
+                }
+                const std::string path = segmentPath_(index);
+                _next_requested = false;
+                reportRollErrors_UnsafeLocked_();
+
+                if (!(_bg_roll && takePrepared_UnsafeLocked_(path)))
+                {
+                    const std::string dir = logDir_();
+                    if (!dir.empty())
+                        platform_createDirectories_(dir);
+                    commitGroup_UnsafeLocked_();
+                    if (_file.is_open())
+                        _file.close();
+                    _file.set_trim_tail(_file_mmap && !binaryFile_()); // 零尾只由映射预留产生
+                    _file.open(path, std::ios::out | (wrap ? std::ios::trunc : std::ios::app) | std::ios::binary);
+                }
+
+                _currentRollIndex = index;
+                _isRoll = wrap;
+                _curFilePath = path; // <== 记录当前文件路径
+                if (!_file.is_open())
+                {
+                    reportError_(std::string("Failed to open new log file: ") + _curFilePath);
+                    _currentSize = 0;
+                    return;
+                }
+
+                _file.seekp(0, std::ios::end);
+                std::streampos pos = _file.tellp();
+                _currentSize = (pos >= 0) ? (size_t)pos : 0u;
+                _heal_counter = 0;
+                onFileOpened_UnsafeLocked_();
+            }
+
+            std::string segmentPath_(int index) const
+            {
+                std::ostringstream fn;
+                fn << _baseFullNameWithDateAndTime << '_' << index << (binaryFile_() ? ".mlb" : ".log");
+                return fn.str();
+            }
+
+            std::string logDir_() const
+            {
+                const size_t p = _baseName.find_last_of("\\/");
+                return p == std::string::npos ? std::string() : _baseName.substr(0, p);
+            }
+
+            // ---------- 后台滚动 ----------
+            // 当前分段写到 3/4 时投递预开任务：后台建目录、按当前流的设置打开下一分段并放进 _next_seg。
+            // 预开从不截断已有文件：绕回（覆盖最旧分段）时先写到临时名 <path>.next，换入时再 rename 覆盖
+            void prepareNext_UnsafeLocked_()
+            {
+                _next_requested = true;
+                int index = _currentRollIndex + 1;
+                bool wrap = _isRoll;
+                if (index > _maxRolls)
+                {
+                    wrap = true;
+                    index = 1;
+                }
+                const std::string path = segmentPath_(index);
+                if (path == _curFilePath) // 只有一个分段：下一段就是当前文件
+                    return;
+#if defined(_WIN32)
+                if (wrap) // 打开中的文件无法被 rename 覆盖：绕回时照常同步滚动
+                    return;
+#endif
+                std::shared_ptr<NextSegment_> slot = _next_seg;
+                {
+                    std::lock_guard<std::mutex> lk(slot->m);
+                    if (slot->pending || (slot->file && slot->path == path))
+                        return;
+                }
+                dropPrepared_UnsafeLocked_(); // 旧的预开结果（配置已变）
+                _next_requested = true;
+                {
+                    std::lock_guard<std::mutex> lk(slot->m);
+                    slot->pending = true;
+                }
+                const std::string dir = logDir_();
+                const std::string target = wrap ? path + ".next" : path;
+                const ML_FastOFStream::Options opt = _file.options();
+                ML_FileRoller::instance().post([slot, path, target, dir, opt, wrap]
+                                               {
+                    std::shared_ptr<ML_FastOFStream> f;
+                    {
+                        std::lock_guard<std::mutex> lk(slot->m);
+                        f.swap(slot->spare); // 复用后台关闭的旧分段流（连同其缓冲），不再每段新分配
+                    }
+                    bool created = false;
+                    try
+                    {
+                        if (!dir.empty())
+                            platform_createDirectories_(dir);
+                        created = createFileExclusive_(target);
+                        if (!f)
+                            f = std::make_shared<ML_FastOFStream>();
+                        f->set_options(opt);
+                        // 临时名归本 logger 所有（可能是上次崩溃的残留），可以截断；正式路径只追加
+                        f->open(target, std::ios::out | (wrap ? std::ios::trunc : std::ios::app) | std::ios::binary);
+                        if (!f->is_open())
+                            f.reset();
+                    }
+                    catch (...)
+                    {
+                        f.reset();
+                    }
+                    {
+                        std::lock_guard<std::mutex> lk(slot->m);
+                        slot->pending = false;
+                        if (!slot->abandoned)
+                        {
+                            slot->file = f;
+                            slot->path = path;
+                            slot->opened = target;
+                            slot->created = created || wrap;
+                            return;
+                        }
+                        slot->abandoned = false;
+                    }
+                    // logger 已改为同步打开：正式路径可能正被写入，原样保留；绕回时的临时名归本任务所有，删除
+                    if (f)
+                        f->close();
+                    if (wrap)
+                        std::remove(target.c_str()); });
+            }
+
+            // 取出预开的分段：路径与设置都符合时换入 _file（绕回时 rename 覆盖最旧分段），旧分段交给后台写出并关闭；
+            // 否则丢弃并返回 false
+            bool takePrepared_UnsafeLocked_(const std::string& path)
+            {
+                Prepared_ pr = takeSlot_UnsafeLocked_();
+                if (!pr.file)
+                    return false;
+                if (pr.path != path || !(pr.file->options() == _file.options()))
+                {
+                    discardSegment_(pr);
+                    return false;
+                }
+                if (pr.opened != path && std::rename(pr.opened.c_str(), path.c_str()) != 0)
+                {
+                    discardSegment_(pr);
+                    return false;
+                }
+                const bool durable = _gc_bytes > 0 && _gc_fsync;
+                _gc_bytes = 0;
+                std::shared_ptr<ML_FastOFStream> f = pr.file;
+                _file.swap(*f);
+                std::shared_ptr<NextSegment_> slot = _next_seg;
+                ML_FileRoller::instance().post([f, durable, slot]
+                                               {
+                    if (durable)
+                        f->sync();
+                    f->close();
+                    if (f->bad()) // 由 logger 在下次滚动/flush 时报告（后台任务不触碰 logger）
+                        slot->close_failed.store(true, std::memory_order_relaxed);
+                    std::lock_guard<std::mutex> lk(slot->m);
+                    if (!slot->spare)
+                        slot->spare = f; });
+                return true;
+            }
+
+            // 换下的旧分段在后台写出/关闭失败时补报错误（原先由 commitGroup_UnsafeLocked_ 同步报告）
+            void reportRollErrors_UnsafeLocked_()
+            {
+                if (_next_seg && _next_seg->close_failed.exchange(false, std::memory_order_relaxed))
+                    reportError_("Log group commit failed on rotated segment.");
+            }
+
+            struct Prepared_
+            {
+                std::shared_ptr<ML_FastOFStream> file;
+                std::string path;   // 将成为的分段路径
+                std::string opened; // 实际打开的路径（绕回时为临时名）
+                bool created = false;
+            };
+
+            // 取走槽内结果。持有 _mutex，不等待进行中的预开：标记放弃后返回空，调用方照常同步打开；
+            // 预开任务完成时自行关闭结果（正式路径的文件原样保留，不会删掉同步打开的分段）
+            Prepared_ takeSlot_UnsafeLocked_()
+            {
+                Prepared_ pr;
+                if (!_next_seg)
+                    return pr;
+                std::lock_guard<std::mutex> lk(_next_seg->m);
+                if (_next_seg->pending)
+                {
+                    _next_seg->abandoned = true;
+                    return pr;
+                }
+                pr.file.swap(_next_seg->file);
+                pr.path.swap(_next_seg->path);
+                pr.opened.swap(_next_seg->opened);
+                pr.created = _next_seg->created;
+                return pr;
+            }
+
+            // 关闭并丢弃尚未使用的预开分段（设置开关、换日、setLogFile、析构/退出、预开结果过期时）
+            void dropPrepared_UnsafeLocked_()
+            {
+                Prepared_ pr = takeSlot_UnsafeLocked_();
+                if (pr.file)
+                    discardSegment_(pr);
+                _next_requested = false;
+            }
+
+            // 预开的流尚未写入，持锁同步关闭；只删除预开任务自己新建（O_EXCL）且仍为空的文件，已有的分段原样保留
+            static void discardSegment_(Prepared_& pr)
+            {
+                pr.file->close();
+                if (!pr.created)
+                    return;
+                struct stat st{};
+                if (::stat(pr.opened.c_str(), &st) == 0 && st.st_size == 0)
+                    std::remove(pr.opened.c_str());
+            }
+
+            // 仅当文件不存在时创建（O_CREAT|O_EXCL）；返回是否由本次调用新建
+            static bool createFileExclusive_(const std::string& path)
+            {
+#if defined(_WIN32)
+                int fd = -1;
+                if (_sopen_s(&fd, path.c_str(), _O_WRONLY | _O_BINARY | _O_CREAT | _O_EXCL, _SH_DENYNO, _S_IREAD | _S_IWRITE) != 0)
+                    return false;
+                _close(fd);
+#else
+                int flags = O_WRONLY | O_CREAT | O_EXCL;
+#if defined(O_CLOEXEC)
+                flags |= O_CLOEXEC;
+#endif
+                int fd;
+                do
+                    fd = ::open(path.c_str(), flags, 0644);
+                while (fd < 0 && errno == EINTR);
+                if (fd < 0)
+                    return false;
+                ::close(fd);
+#endif
+                return true;
+            }
+
+            std::string currentTimestamp_() const
+            {
+                auto now = std::chrono::system_clock::now();
+                std::time_t t = std::chrono::system_clock::to_time_t(now);
+                std::tm lt{};
+#if defined(_WIN32)
+                localtime_s(&lt, &t);
+#else
+                localtime_r(&t, &lt);
+#endif
+                char buf[64];
+                if (_default_file_name_day)
+                    std::strftime(buf, sizeof(buf), "%Y%m%d", &lt);
+                else
+                    std::strftime(buf, sizeof(buf), "%Y%m%d%H%M", &lt);
+                return std::string(buf);
+            }
+
+            static const char* levelColorAnsi_(Level lv)
+            {
+                switch (lv)
+                {
+                case Level::Debug:
+                    return MLLOG_COLOR_GREEN;
+                case Level::Info:
+                    return MLLOG_COLOR_CYAN;
+                case Level::Notice:
+                    return MLLOG_COLOR_BLUE;
+                case Level::Warning:
+                    return MLLOG_COLOR_YELLOW;
+                case Level::Error:
+                    return MLLOG_COLOR_RED;
+                case Level::Critical:
+                    return MLLOG_COLOR_MAGENTA;
+                case Level::Alert:
+                    return MLLOG_COLOR_WHITE;
+                default:
+                    return MLLOG_EMPTY;
+                }
+            }
+
+            void reportError_(const std::string& m)
+            {
+                if (in_logging_flag_())
+                {
+                    try
+                    {
+                        std::cerr << "MLLOG CRITICAL: " << m << std::endl;
+                    }
+                    catch (...)
+                    {
+                    }
+                    return;
+                }
+                auto h = _error_handler;
+                if (h)
+                {
+                    try
+                    {
+                        h(std::string("MLLOG INTERNAL: ") + m);
+                    }
+                    catch (...)
+                    {
+                    }
+                }
+                else
+                {
+                    try
+                    {
+                        std::cerr << "MLLOG CRITICAL: " << m << std::endl;
+                    }
+                    catch (...)
+                    {
+                    }
+                }
+            }
+
+            static bool platform_createDirectories_(const std::string& path)
+            {
+#if defined(_WIN32)
+                if (path.empty())
+                    return true;
+
+                std::string p = path;
+                std::replace(p.begin(), p.end(), '/', '\\');
+
+                std::string cur;
+                size_t i = 0;
+
+                // UNC: \\server\share\...
+                if (p.size() >= 2 && p[0] == '\\' && p[1] == '\\')
+                {
+                    size_t j = p.find('\\', 2);
+                    if (j == std::string::npos)
+                        return false; // \\server
+                    size_t k = p.find('\\', j + 1);
+                    if (k == std::string::npos)
+                        return false;     // \\server\share (缺少后续分隔)
+                    cur = p.substr(0, k); // \\server\share
+                    i = k + 1;            // 跳过 '\'
+                    // UNC 根不 mkdir
+                }
+                // 盘符: X:\...
+                else if (p.size() >= 2 && std::isalpha((unsigned char)p[0]) && p[1] == ':')
+                {
+                    cur = p.substr(0, 2); // "X:"
+                    i = 2;
+                    if (i < p.size() && p[i] == '\\')
+                    {
+                        cur += '\\';
+                        ++i;
+                    } // "X:\"
+                    // 不对 "X:" / "X:\" 调 mkdir
+                }
+
+                // 逐段创建
+                while (i < p.size())
+                {
+                    while (i < p.size() && p[i] == '\\')
+                        ++i;
+                    if (i >= p.size())
+                        break;
+                    size_t j = p.find('\\', i);
+                    std::string seg = (j == std::string::npos) ? p.substr(i) : p.substr(i, j - i);
+                    i = (j == std::string::npos) ? p.size() : j + 1;
+
+                    if (seg.empty() || seg == ".")
+                        continue;
+
+                    if (!cur.empty() && cur.back() != '\\')
+                        cur.push_back('\\');
+                    cur += seg;
+
+                    if (_mkdir(cur.c_str()) != 0 && errno != EEXIST)
+                        return false;
+                }
+                return true;
+#else
+                // 你的原 *nix 实现就行
+                std::string q = path;
+                std::replace(q.begin(), q.end(), '\\', '/');
+                if (q.empty())
+                    return true;
+                std::string cur = (q[0] == '/') ? std::string("/") : std::string();
+                std::stringstream ss(q);
+                std::string seg;
+                while (std::getline(ss, seg, '/'))
+                {
+                    if (seg.empty() || seg == ".")
+                        continue;
+                    if (!cur.empty() && cur.back() != '/')
+                        cur.push_back('/');
+                    cur += seg;
+                    if (::mkdir(cur.c_str(), 0755) != 0 && errno != EEXIST)
+                        return false;
+                }
+                return true;
+#endif
+            }
+
+            static std::string platform_getModulePath_()
+            {
+                char buf[1024] = {0};
+#if defined(_WIN32)
+                HMODULE h = nullptr;
+                if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                                       reinterpret_cast<LPCSTR>(&platform_getModulePath_), &h))
+                {
+                    char path[MAX_PATH] = {0};
+                    DWORD n = GetModuleFileNameA(h, path, MAX_PATH);
+                    if (n > 0)
+                    {
+                        std::string p(path, n);
+                        size_t pos = p.find_last_of("\\/");
+                        return (pos != std::string::npos) ? p.substr(0, pos) : ".";
+                    }
+                }
+                char* exe = nullptr;
+                if (_get_pgmptr(&exe) == 0 && exe)
+                {
+                    std::string p(exe);
+                    size_t pos = p.find_last_of("\\/");
+                    return (pos != std::string::npos) ? p.substr(0, pos) : ".";
+                }
+                if (_getcwd(buf, (int)sizeof(buf)))
+                    return std::string(buf);
+                return ".";
+#else
+                Dl_info info{};
+                if (dladdr((void*)(&platform_getModulePath_), &info) && info.dli_fname)
+                {
+                    std::string p(info.dli_fname);
+                    size_t pos = p.find_last_of('/');
+                    return (pos != std::string::npos) ? p.substr(0, pos) : ".";
+                }
+                if (getcwd(buf, sizeof(buf)) != nullptr)
+                    return std::string(buf);
+                return ".";
+#endif
+            }
+
+            static std::string platform_getModuleBasename_()
+            {
+#if defined(_WIN32)
+                HMODULE h = nullptr;
+                if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                                       reinterpret_cast<LPCSTR>(&platform_getModuleBasename_), &h))
+                {
+                    char path[MAX_PATH] = {0};
+                    DWORD n = GetModuleFileNameA(h, path, MAX_PATH);
+                    if (n)
+                    {
+                        std::string p(path, n);
+                        size_t pos = p.find_last_of("\\/");
+                        std::string b = (pos == std::string::npos) ? p : p.substr(pos + 1);
+                        size_t dot = b.rfind('.');
+                        if (dot != std::string::npos)
+                            b.resize(dot);
+                        return b;
+                    }
+                }
+                return platform_getProcessName_();
+#else
+                Dl_info info{};
+                if (dladdr((void*)(&platform_getModuleBasename_), &info) && info.dli_fname)
+                {
+                    std::string p(info.dli_fname);
+                    size_t pos = p.find_last_of('/');
+                    std::string b = (pos == std::string::npos) ? p : p.substr(pos + 1);
+                    size_t dot = b.rfind('.');
+                    if (dot != std::string::npos)
+                        b.resize(dot);
+                    return b;
+                }
+                return platform_getProcessName_();
+#endif
+            }
+
+            static std::string platform_getProcessName_()
+            {
+                char buf[1024] = {0};
+#if defined(_WIN32)
+                char* exe = nullptr;
+                if (_get_pgmptr(&exe) == 0 && exe)
+                {
+                    std::string n(exe);
+                    size_t p = n.find_last_of("\\/");
+                    if (p != std::string::npos)
+                        n = n.substr(p + 1);
+                    p = n.rfind('.');
+                    if (p != std::string::npos)
+                        n = n.substr(0, p);
+                    return n;
+                }
+                return "unknown_process";
+#else
+                ssize_t r = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+                if (r > 0)
+                    buf[r] = '\0';
+                if (r > 0)
+                {
+                    std::string n(buf);
+                    size_t p = n.find_last_of('/');
+                    if (p != std::string::npos)
+                        n = n.substr(p + 1);
+                    return n;
+                }
+                return "unknown_process";
+#endif
+            }
+
+            static std::string platform_currentDirWithSlash_()
+            {
+                char buf[1024] = {0};
+#if defined(_WIN32)
+                if (_getcwd(buf, (int)sizeof(buf)) != nullptr)
+                    return std::string(buf) + "\\";
+#else
+                if (getcwd(buf, sizeof(buf)) != nullptr)
+                    return std::string(buf) + "/";
+#endif
+                return std::string();
+            }
+
+            static std::vector<std::string> platform_listLogFiles_(const std::string& dir, const std::string& stem)
+            {
+                std::vector<std::string> out;
+#if defined(_WIN32)
+                std::string search = dir;
+                if (!search.empty())
+                {
+                    char back = search.back();
+                    if (back != '\\' && back != '/')
+                        search.push_back('\\');
+                }
+                search += stem + "_*";
+                struct _finddata_t f;
+                intptr_t h = _findfirst(search.c_str(), &f);
+                if (h != -1)
+                {
+                    do
+                    {
+                        if (!(f.attrib & _A_SUBDIR))
+                            out.emplace_back(f.name);
+                    } while (_findnext(h, &f) == 0);
+                    _findclose(h);
+                }
+#else
+                if (DIR* d = opendir(dir.c_str()))
+                {
+                    while (dirent* e = readdir(d))
+                    {
+                        if (e->d_type == DT_REG || e->d_type == DT_LNK)
+                        {
+                            std::string n = e->d_name;
+                            if (n.rfind(stem + "_", 0) == 0)
+                                out.emplace_back(n);
+                        }
+                        else if (e->d_type == DT_UNKNOWN)
+                        {
+                            std::string full = dir;
+                            if (!full.empty() && full.back() != '/')
+                                full.push_back('/');
+                            full += e->d_name;
+                            struct stat st{};
+                            if (::stat(full.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+                            {
+                                std::string n = e->d_name;
+                                if (n.rfind(stem + "_", 0) == 0)
+                                    out.emplace_back(n);
+                            }
+                        }
+                    }
+                    closedir(d);
+                }
+#endif
+                std::sort(out.begin(), out.end());
+                return out;
+            }
+
+            static void platform_deleteFile_(const std::string& full)
+            {
+                if (std::remove(full.c_str()) != 0)
+                {
+#if defined(_WIN32)
+                    std::cerr << "MLLOG CRITICAL: Failed to delete file: " << full << std::endl;
+#else
+                    std::cerr << "MLLOG CRITICAL: Failed to delete file: " << full << ", errno=" << errno << std::endl;
+#endif
+                }
+            }
+
+            bool shouldDeleteLog_(const std::string& filename, int days) const
+            {
+                const std::time_t ft = parseDateFromFilename_(filename);
+                if (ft == (time_t)-1)
+                    return false;
+                const std::time_t now = std::time(nullptr);
+                return std::difftime(now, ft) > double(days) * 24.0 * 3600.0;
+            }
+
+            std::time_t parseDateFromFilename_(const std::string& filename) const
+            {
+                if (filename.rfind(_baseNameWithoutPath + "_", 0) != 0)
+                    return (time_t)-1;
+                std::string rest = filename.substr(_baseNameWithoutPath.length() + 1);
+                if (rest.size() < 8)
+                    return (time_t)-1;
+                std::string ymd = rest.substr(0, 8);
+                for (char c : ymd)
+                    if (!std::isdigit(static_cast<unsigned char>(c)))
+                        return (time_t)-1;
+                std::tm tmv{};
+                try
+                {
+                    tmv.tm_year = std::stoi(ymd.substr(0, 4)) - 1900;
+                    tmv.tm_mon = std::stoi(ymd.substr(4, 2)) - 1;
+                    tmv.tm_mday = std::stoi(ymd.substr(6, 2));
+                    tmv.tm_isdst = -1;
+                }
+                catch (...)
+                {
+                    return (time_t)-1;
+                }
+                return std::mktime(&tmv);
+            }
+
+            // ---------- Pattern 引擎（NEW） ----------
+            enum class PatType
+            {
+                Lit,
+                DateChunk,
+                Ms,
+                LevelShort,
+                LevelLong,
+                PID,
+                TID,
+                FileShort,
+                FileFull,
+                Line,
+                Func,
+                Message,
+                ColorStart,
+                ColorStop
+            };
+
+            struct PatOp
+            {
+                PatType type;
+                std::string text;
+            };
+            struct CompiledPattern_
+            {
+                std::string raw;
+                std::vector<PatOp> ops;
+                bool has_date = false;
+                unsigned long long serial = 0; // 进程内唯一，作 DateChunk 缓存的键（指针可能被复用）
+            };
+
+            // 每线程按秒缓存各 DateChunk 的 strftime 结果；少量槽位轮换，兼顾多个 logger / pattern 交替使用
+            struct DateCache_
+            {
+                unsigned long long serial = 0;
+                long long sec_key = -1;
+                std::vector<std::string> chunks; // 与 ops 下标对应，仅 DateChunk 位置有内容
+            };
+            static DateCache_& dateCache_(const CompiledPattern_& pat, const std::tm& tmv)
+            {
+                thread_local DateCache_ slots[4];
+                thread_local unsigned victim = 0;
+                DateCache_* c = nullptr;
+                for (auto& sl : slots)
+                    if (sl.serial == pat.serial)
+                    {
+                        c = &sl;
+                        break;
+                    }
+                if (!c)
+                {
+                    c = &slots[victim++ & 3u];
+                    c->serial = pat.serial;
+                    c->sec_key = -1;
+                    c->chunks.assign(pat.ops.size(), std::string());
+                }
+                const long long key = secKey_(tmv);
+                if (key != c->sec_key)
+                {
+                    c->sec_key = key;
+                    for (size_t k = 0; k < pat.ops.size(); ++k)
+                        if (pat.ops[k].type == PatType::DateChunk)
+                            strftimeChunk_(pat.ops[k].text, tmv, c->chunks[k]);
+                }
+                return *c;
+            }
+            static void strftimeChunk_(const std::string& fmt, const std::tm& tmv, std::string& out)
+            {
+                out.clear();
+                char sbuf[128];
+                size_t n = std::strftime(sbuf, sizeof(sbuf), fmt.c_str(), &tmv);
+                if (n > 0)
+                {
+                    out.assign(sbuf, n);
+                    return;
+                }
+                for (size_t cap = 256; cap <= 4096; cap <<= 1) // 安全上限
+                {
+                    out.assign(cap, '\0');
+                    n = std::strftime(&out[0], out.size(), fmt.c_str(), &tmv);
+                    if (n > 0)
+                    {
+                        out.resize(n);
+                        return;
+                    }
+                }
+                out.clear();
+            }
+
+            // 编译 pattern 为 token 序列；把时间片段（含多种 %X 与字面）聚合成单个 DateChunk
+            static bool is_time_spec_char_(char c)
+            {
+                return std::isalpha(static_cast<unsigned char>(c)) ? true : false;
+            }
+
+            bool compilePattern_(const std::string& p, std::vector<PatOp>& out)
+            {
+                if (p.empty())
+                    return false;
+                out.clear();
+                std::string lit, datechunk;
+                auto flush_lit = [&]()
+                { if (!lit.empty()) { out.push_back({ PatType::Lit, lit }); lit.clear(); } };
+                auto flush_date = [&]()
+                { if (!datechunk.empty()) { out.push_back({ PatType::DateChunk, datechunk }); datechunk.clear(); } };
+
+                for (size_t i = 0; i < p.size(); ++i)
+                {
+                    if (p[i] != '%')
+                    {
+                        if (!datechunk.empty())
+                            datechunk.push_back(p[i]);
+                        else
+                            lit.push_back(p[i]);
+                        continue;
+                    }
+                    if (i + 1 >= p.size())
+                    {
+                        (datechunk.empty() ? lit : datechunk).push_back('%');
+                        break;
+                    }
+                    char c = p[i + 1];
+                    i++;
+                    switch (c)
+                    {
+                    case 'v':
+                        flush_date();
+                        flush_lit();
+                        out.push_back({PatType::Message, {}});
+                        break;
+                    case 'l':
+                        flush_date();
+                        flush_lit();
+                        out.push_back({PatType::LevelShort, {}});
+                        break;
+                    case 'L':
+                        flush_date();
+                        flush_lit();
+                        out.push_back({PatType::LevelLong, {}});
+                        break;
+                    case 'n': // 实例名不可变：编译时直接并入字面量
+                        if (!datechunk.empty())
+                        {
+                            flush_date();
+                            flush_lit();
+                        }
+                        lit += _name;
+                        break;
+                    case 'P':
+                        flush_date();
+                        flush_lit();
+                        out.push_back({PatType::PID, {}});
+                        break;
+                    case 't':
+                        flush_date();
+                        flush_lit();
+                        out.push_back({PatType::TID, {}});
+                        break;
+                    case 's':
+                        flush_date();
+                        flush_lit();
+                        out.push_back({PatType::FileShort, {}});
+                        break;
+                    case 'g':
+                        flush_date();
+                        flush_lit();
+                        out.push_back({PatType::FileFull, {}});
+                        break; // [NEW] 全路径
+                    case '#':
+                        flush_date();
+                        flush_lit();
+                        out.push_back({PatType::Line, {}});
+                        break;
+                    case '!':
+                        flush_date();
+                        flush_lit();
+                        out.push_back({PatType::Func, {}});
+                        break; // [NEW] 函数名
+                    case '^':
+                        flush_date();
+                        flush_lit();
+                        out.push_back({PatType::ColorStart, {}});
+                        break;
+                    case '$':
+                        flush_date();
+                        flush_lit();
+                        out.push_back({PatType::ColorStop, {}});
+                        break;
+                    case 'e': // 毫秒：在此处切开 DateChunk，使每个 DateChunk 只依赖秒级时间、可按秒缓存
+                        flush_date();
+                        flush_lit();
+                        out.push_back({PatType::Ms, {}});
+                        break;
+                    default:
+                        if (datechunk.empty())
+                            flush_lit();
+                        datechunk.push_back('%');
+                        datechunk.push_back(c);
+                        if (!is_time_spec_char_(c))
+                        {
+                        }
+                        break;
+                    }
+                }
+                flush_date();
+                flush_lit();
+                return !out.empty();
+            }
+
+            void renderPattern_(const CompiledPattern_& pat, const std::tm& tmv, int ms, Level lv,
+                                const char* file_short, const char* file_full, const char* func, int line,
+                                const char* msg, size_t msg_n, std::string& out, unsigned tid = current_tid_(), unsigned pid = 0) const
+            {
+                const char* level_str = levelToStringC_(lv);
+                DateCache_* dc = pat.has_date ? &dateCache_(pat, tmv) : nullptr;
+                for (size_t k = 0; k < pat.ops.size(); ++k)
+                {
+                    const PatOp& op = pat.ops[k];
+                    switch (op.type)
+                    {
+                    case PatType::Lit:
+                        out.append(op.text);
+                        break;
+                    case PatType::LevelShort:
+                    case PatType::LevelLong:
+                        out.append(level_str);
+                        break;
+                    case PatType::PID:
+                        if (pid == 0) // 解码二进制日志时由调用方传入写入端的进程号
+                        {
+#if defined(_WIN32)
+                            pid = GetCurrentProcessId();
+#else
+                            pid = (unsigned)getpid();
+#endif
+                        }
+                        ml_append_uint(out, pid);
+                        break;
+                    case PatType::TID:
+                        ml_append_uint(out, tid);
+                        break;
+                    case PatType::FileShort:
+                        out.append(file_short ? file_short : "?");
+                        break;
+                    case PatType::FileFull:
+                        out.append(file_full ? file_full : "?");
+                        break;
+                    case PatType::Line:
+                        ml_append_int(out, line);
+                        break;
+                    case PatType::Func:
+                        out.append(func ? func : "?");
+                        break;
+                    case PatType::Message:
+                        out.append(msg, msg_n);
+                        break;
+                    case PatType::Ms:
+                    {
+                        const char b[3] = {(char)('0' + ms / 100 % 10), (char)('0' + ms / 10 % 10), (char)('0' + ms % 10)};
+                        out.append(b, 3);
+                    }
+                    break;
+                    case PatType::DateChunk:
+                        out.append(dc->chunks[k]);
+                        break;
+                    case PatType::ColorStart:
+                    case PatType::ColorStop:
+                        // 忽略（仍采用整行按级别上色，不污染文件）
+                        break;
+                    }
+                }
+            }
+            // 秒级时间键：按秒缓存格式化结果时使用
+            static long long secKey_(const std::tm& tmv)
+            {
+                return ((((long long)tmv.tm_year * 400 + tmv.tm_yday) * 24 + tmv.tm_hour) * 60 + tmv.tm_min) * 61 + tmv.tm_sec;
+            }
+
+            // ISO-8601 本地时间（毫秒 + 时区偏移），秒级部分按线程缓存
+            static void appendIsoTime_(const std::tm& tmv, int ms, std::string& out)
+            {
+                struct TLS
+                {
+                    long long key = -1;
+                    char date[32];
+                    size_t date_n = 0;
+                    char tz[8];
+                    size_t tz_n = 0;
+                };
+                thread_local TLS c;
+                const long long key = secKey_(tmv);
+                if (key != c.key)
+                {
+                    c.key = key;
+                    c.date_n = std::strftime(c.date, sizeof(c.date), "%Y-%m-%dT%H:%M:%S", &tmv);
+                    char z[16];
+                    c.tz_n = 0;
+                    if (std::strftime(z, sizeof(z), "%z", &tmv) == 5) // "+0800" → "+08:00"
+                    {
+                        const char tz[6] = {z[0], z[1], z[2], ':', z[3], z[4]};
+                        std::memcpy(c.tz, tz, sizeof(tz));
+                        c.tz_n = sizeof(tz);
+                    }
+                }
+                out.append(c.date, c.date_n);
+                const char msb[4] = {'.', (char)('0' + ms / 100 % 10), (char)('0' + ms / 10 % 10), (char)('0' + ms % 10)};
+                out.append(msb, sizeof(msb));
+                out.append(c.tz, c.tz_n);
+            }
+
+            // JSON-lines 渲染；正文（含结尾的 CR/LF）整体转义进 "msg"，对象后恰好跟一个 '\n'
+            void renderJson_(const std::tm& tmv, int ms, Level lv, const char* file_short, int line,
+                             const char* msg, size_t msg_n, const char* kv, size_t kv_n, std::string& out) const
+            {
+                out.append("{\"ts\":\"", 7);
+                appendIsoTime_(tmv, ms, out);
+                out.append("\",\"level\":\"", 11);
+                out.append(levelToStringC_(lv));
+                out.append("\",\"logger\":", 11);
+                ml_json_string(out, _name.data(), _name.size());
+                out.append(",\"file\":", 8);
+                const char* fs = file_short ? file_short : "?";
+                ml_json_string(out, fs, std::strlen(fs));
+                out.append(",\"line\":", 8);
+                ml_append_int(out, line);
+                out.append(",\"msg\":", 7);
+                ml_json_string(out, msg, msg_n); // 结尾的 CR/LF 也转义在 "msg" 内
+                if (kv_n)
+                    ML_ArgCodec::render_fields_json(kv, kv_n, out);
+                out.append("}\n", 2); // 每个对象恰以一个换行结束，调用方不再补换行
+            }
+
+            void maybeHealUnlinked_()
+            {
+#if defined(_WIN32)
+                (void)0;
+#else
+                if (_heal_every <= 0 || !_outputToFile || !_file.is_open() || _curFilePath.empty())
+                    return;
+                if (++_heal_counter < _heal_every)
+                    return;
+                _heal_counter = 0;
+
+                // 先取“路径是否存在 + inode 是否匹配”
+                bool need_reopen = false;
+                struct stat st_path{};
+                if (::stat(_curFilePath.c_str(), &st_path) != 0)
+                {
+                    // 路径不存在（被 unlink）
+                    need_reopen = true;
+                }
+                else
+                {
+                    int fd = _file.native_fileno(); // <== 需要补丁 A
+                    if (fd >= 0)
+                    {
+                        struct stat st_fd{};
+                        if (::fstat(fd, &st_fd) == 0)
+                        {
+                            // dev/inode 变化 => 我们拿的是“旧文件”，路径上是“新文件”
+                            if (st_fd.st_dev != st_path.st_dev || st_fd.st_ino != st_path.st_ino)
+                                need_reopen = true;
+                        }
+                    }
+                }
+
+                if (need_reopen)
+                {
+                    _file.close();
+                    _file.open(_curFilePath, std::ios::out | std::ios::app | std::ios::binary);
+                    if (_file.is_open())
+                    {
+                        _file.seekp(0, std::ios::end);
+                        std::streampos pos = _file.tellp();
+                        _currentSize = (pos >= 0) ? (size_t)pos : 0u;
+                        onFileOpened_UnsafeLocked_();
+                    }
+                    else
+                    {
+                        reportError_(std::string("Heal reopen failed: ") + _curFilePath);
+                        _initialized = false; // 让后续写入触发 rollFiles_()
+                    }
+                }
+#endif
+            }
+
+        private:
+            ML_FastOFStream _file;
+            std::mutex _mutex;
+            std::string _name; // [NEW] 实例名（%n）
+            std::string _baseName;
+            std::string _baseNameWithoutPath;
+            std::string _baseFullNameWithDateAndTime;
+            bool _isRoll;
+            Level _logLevel;
+            bool _outputToFile;
+            bool _outputToScreen;
+            int _currentRollIndex;
+            int _maxRolls;
+            size_t _maxSizeInBytes;
+            size_t _currentSize;
+            bool _initialized;
+            bool _message_only;
+            bool _add_newline;
+            bool _log_enabled;
+            bool _log_screen_color;
+            std::atomic<bool> _screen_async{false};
+            bool _default_file_name_day;
+            bool _isCheckDay;
+            std::string _start_timestamp;
+            std::atomic<int> _last_log_ymd;
+            bool _auto_flush;
+            // 组提交（持有 _mutex 访问）
+            std::atomic<bool> _group_commit{false}; // 写线程空闲检查时不持锁读取
+            bool _gc_fsync = false;
+            size_t _gc_max_bytes = 256u * 1024u;
+            unsigned _gc_max_delay_us = 1000;
+            size_t _gc_bytes = 0; // 本批未提交字节
+            std::chrono::steady_clock::time_point _gc_since;
+            std::atomic<bool> _need_day_switch;
+            ErrorHandler _error_handler;
+            static constexpr size_t PENDING_MAX_BYTES = 4u * 1024u * 1024u;
+            static constexpr size_t PENDING_MAX_COUNT = 2000u;
+            std::deque<std::string> _pending;
+            size_t _pending_bytes;
+            std::atomic<int> _phase;
+
+            // 异步模式状态
+            static constexpr size_t ASYNC_SLOT_RESERVE = 256u; // 每个槽位预留的正文容量
+            static constexpr size_t ASYNC_BATCH_MAX = 512u;    // 写线程单批最多取出的记录数
+            static constexpr size_t ASYNC_SLOT_SHRINK = 64u * 1024u;
+            static constexpr size_t FORMAT_BUF_SHRINK = 64u * 1024u; // logformat 线程私有缓冲保留的最大容量
+            std::atomic<bool> _async_on{false};
+            std::atomic<bool> _async_stop{false};
+            std::atomic<bool> _async_idle{false};
+            std::atomic<AsyncRing_*> _async_ring{nullptr};
+            std::vector<std::unique_ptr<AsyncRing_>> _async_rings; // 当前及已退役的队列（随实例释放）
+            std::atomic<size_t> _async_done{0};                    // 已写出（或被 DropOldest 淘汰）的记录数
+            std::atomic<size_t> _async_base{0};                    // 本次启动时队列已有的入队数
+            std::thread _async_thread;
+            std::atomic<std::thread::id> _async_tid{std::thread::id()};
+            std::mutex _async_ctl_mutex;      // 串行化 setAsync()
+            std::mutex _async_consumer_mutex; // 保证队列单消费者
+            std::mutex _async_wait_mutex;
+            std::condition_variable _async_cv;
+            std::atomic<int> _async_overflow{(int)AsyncOverflow::Block};
+            std::atomic<size_t> _async_dropped{0};                   // 待输出统计行的丢弃数
+            std::atomic<unsigned long long> _async_dropped_total{0}; // 累计丢弃数
+            static constexpr size_t SPILL_MAX_BYTES = PENDING_MAX_BYTES;
+            static constexpr size_t SPILL_MAX_COUNT = 16u * 1024u;
+            std::deque<AsyncRecord_> _async_spill;
+            size_t _async_spill_bytes = 0;
+            std::atomic<size_t> _async_spill_count{0}; // 溢出缓冲中（含正在写出）的记录数
+            std::mutex _async_spill_mutex;
+            std::atomic<int> _async_queue{(int)AsyncQueue::Shared};
+            std::atomic<bool> _deferred_format{false};
+            std::string _deferred_msg;  // 写线程渲染延迟记录用（持有 _mutex）
+            std::string _deferred_line; // 同上
+            std::string _sync_record;   // writeRecordNow_ 的正文副本（持有 _mutex）
+            std::string _fields_msg;    // 文本行格式用的“正文 + 字段”（持有 _mutex）
+            std::atomic<bool> _json_lines{false};
+            // 二进制文件格式（以下非原子成员均持有 _mutex 访问）
+            std::atomic<int> _file_format{(int)FileFormat::Text};
+            bool _file_mmap = false;
+            bool _file_sigbus = false;
+            bool _file_uring = false;
+            bool _file_prealloc = false;
+            size_t _file_writeback = 0;
+            // 后台滚动（持有 _mutex 访问 _next_seg 指针与 _next_requested；槽内字段由 m 保护）
+            struct NextSegment_
+            {
+                std::mutex m;
+                std::shared_ptr<ML_FastOFStream> file; // 已预开、尚未使用的下一分段
+                std::shared_ptr<ML_FastOFStream> spare; // 后台关闭后的旧分段流：下次预开复用其缓冲
+                std::string path;                      // 将成为的分段路径
+                std::string opened;                    // 实际打开的路径（绕回时为临时名）
+                bool created = false;                  // 文件由预开任务新建（丢弃时才可删除）
+                bool pending = false;                  // 预开任务进行中
+                bool abandoned = false;                // 预开进行中时 logger 已改为同步打开：任务完成后自行关闭结果
+                std::atomic<bool> close_failed{false}; // 后台关闭旧分段失败，待 logger 报告
+            };
+            std::shared_ptr<NextSegment_> _next_seg; // 首次开启后常驻：关闭后台滚动后 flush() 仍需等待旧分段写完
+            bool _bg_roll = false;
+            bool _next_requested = false;
+            std::string _bin_buf;                // 待写出的编码记录
+            std::vector<bool> _bin_sites;        // 当前文件已写出定义的调用点 id
+            unsigned long long _bin_pattern = 0; // 当前文件最近写出的 pattern（serial + 1；0 为尚未写出）
+            unsigned char _bin_pattern_flags = 0; // 同上：bit0 message_only，bit1 JSON-lines
+            std::atomic<unsigned> _async_epoch{0}; // 每次 setAsync 启动递增，PerThread 据此重新登记线程环
+            std::atomic<size_t> _async_thread_bytes{256u * 1024u};
+            const unsigned long long _uid = next_uid_().fetch_add(1, std::memory_order_relaxed) + 1; // 进程内唯一，作线程环登记键
+            std::vector<std::shared_ptr<ThreadRing_>> _thread_rings;
+            std::atomic<size_t> _thread_rings_version{0};
+            std::mutex _thread_rings_mutex;
+            // Block 策略的睡眠等待：写线程每腾出空位递增 _async_space_gen，有等待者时唤醒
+            std::atomic<unsigned> _async_space_gen{0};
+            std::atomic<unsigned> _async_space_waiters{0};
+            std::mutex _async_space_mutex;
+            std::condition_variable _async_space_cv;
+
+            // Pattern 状态
+            std::string _pattern_raw; // [NEW]
+            std::atomic<const CompiledPattern_*> _pattern{nullptr};
+            std::vector<std::unique_ptr<CompiledPattern_>> _patterns; // 已发布过的各个不同 pattern（读者可能仍持有旧指针）
+
+            // 附加 sink：相同行格式的 sink 共用一个 slot。整组为不可变快照（增删时复制后替换，持有 _mutex 读写），
+            // 写出端在锁内取快照并渲染，解锁后才调用 sink
+            struct SinkSlot_
+            {
+                SinkFormat::Kind kind;
+                std::string key; // Pattern 时为原始 pattern 串
+                std::unique_ptr<CompiledPattern_> pat; // 编译失败时为空，按默认前缀渲染
+            };
+            struct SinkEntry_
+            {
+                std::shared_ptr<Sink> sink;
+                Level level;
+                size_t slot;
+            };
+            struct SinkSet_
+            {
+                std::vector<SinkEntry_> sinks;
+                std::vector<std::shared_ptr<SinkSlot_>> slots; // 各快照共享；不再被引用的 slot 随快照释放
+            };
+            std::shared_ptr<const SinkSet_> _sinks; // 无 sink 时为空
+            std::atomic<bool> _has_sinks{false};
+
+            // 一条待投递的 sink 记录（各行格式的整行已渲染，正文/字段为拷贝）；队列每线程一份，缓冲复用
+            struct SinkDelivery_
+            {
+                ML_Logger* owner = nullptr;
+                std::shared_ptr<const SinkSet_> set;
+                long long ts_ns = 0;
+                Level lv = Level::Debug;
+                const char* file_short = nullptr;
+                const char* file_full = nullptr;
+                const char* func = nullptr;
+                int line = 0;
+                unsigned tid = 0;
+                std::string msg;
+                std::string kv;
+                std::vector<std::string> lines; // 按 slot
+                std::vector<unsigned char> ready;
+            };
+            struct SinkOutbox_
+            {
+                std::deque<SinkDelivery_> items;
+                size_t n = 0;
+                bool delivering = false;
+            };
+            static SinkOutbox_& sink_outbox_()
+            {
+                thread_local SinkOutbox_ ob;
+                return ob;
+            }
+
+            std::string _curFilePath; // 当前打开并写入的文件完整路径
+            int _heal_every = 256;    // 每写多少行做一次自愈检查（0=关闭）
+            int _heal_counter = 0;    // 计数器
+
+            static bool& in_logging_flag_()
+            {
+                thread_local bool flag = false;
+                return flag;
+            }
+        };
+
+        /* =================== Registry 方法定义 =================== */
+        inline ML_LoggerRegistry& ML_LoggerRegistry::getInstance()
+        {
+            static ML_LoggerRegistry* p = []
+            {
+                ML_LoggerRegistry* r = new ML_LoggerRegistry(); // 永不析构
+                ML_FileRoller::instance();                      // 先于退出钩子构造：析构（join 后台线程）在各 logger 退出 flush 之后
+                std::atexit(&ML_LoggerRegistry::flushAllAtExit_);
+                return r;
+            }();
+            return *p;
+        }
+        inline void ML_LoggerRegistry::flushAllAtExit_()
+        {
+            if (const Snapshot_* snap = getInstance()._snapshot.load(std::memory_order_acquire))
+                for (const auto& kv : *snap)
+                    kv.second->flushAtExit_();
+        }
+        inline ML_Logger& ML_LoggerRegistry::get(const std::string& name)
+        {
+            if (const Snapshot_* snap = _snapshot.load(std::memory_order_acquire))
+            {
+                auto hit = snap->find(name);
+                if (hit != snap->end())
+                    return *hit->second;
+            }
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _loggers.find(name);
+            if (it == _loggers.end())
+            {
+                it = _loggers.emplace(name, std::unique_ptr<ML_Logger>(new ML_Logger(name))).first; // [CHG]
+                std::unique_ptr<Snapshot_> next(new Snapshot_());
+                for (const auto& kv : _loggers)
+                    next->emplace(kv.first, kv.second.get());
+                _snapshot.store(next.get(), std::memory_order_release);
+                _snapshots.push_back(std::move(next));
+            }
+            return *it->second;
+        }
+        inline ML_LoggerRegistry::~ML_LoggerRegistry() = default;
+
+        // 解码使用一个不输出的本地实例：pattern 编译（%n 取文件头中的实例名）与渲染与写入端完全同一套代码
+        inline bool ML_Logger::decodeBinaryLog(std::istream& in, std::ostream& out, const std::string& pattern)
+        {
+            auto read = [&](void* p, size_t n)
+            { return n == 0 || (bool)in.read(static_cast<char*>(p), (std::streamsize)n); };
+            auto readU32 = [&](uint32_t& v)
+            {
+                char b[4];
+                if (!read(b, 4))
+                    return false;
+                ml_load_le(v, b);
+                return true;
+            };
+            char magic[8];
+            uint32_t version = 0, order = 0, pid = 0, name_n = 0;
+            unsigned char ptr_size = 0;
+            if (!read(magic, sizeof(magic)) || std::memcmp(magic, "MLLOGBIN", sizeof(magic)) != 0 ||
+                !readU32(version) || !readU32(order) || !read(&ptr_size, 1) || !readU32(pid) || !readU32(name_n))
+                return false;
+            // 版本 1 为写出端本机字节序：只有 64 位小端写出的（字节序标记按小端读出一致、指针 8 字节）与版本 2 相同
+            if (order != BIN_BYTE_ORDER || !(version == BIN_VERSION || (version == 1 && ptr_size == 8)))
+                return false;
+            std::string name(name_n, '\0');
+            if (!read(&name[0], name_n))
+                return false;
+
+            ML_Logger dec(name);
+            const bool fixed = !pattern.empty();
+            if (fixed)
+                dec.setPattern(pattern);
+
+            struct Site
+            {
+                uint32_t line = 0;
+                std::string file_short = "?", file_full = "?", func = "?";
+            };
+            std::vector<Site> sites;
+            std::string body, raw, msg, line;
+            // 记录长度来自文件，损坏时可能极大：可定位的输入先取总长，超出剩余字节即判为损坏；
+            // 管道输入按块读入，缓冲只随实际读到的数据增长
+            long long total = -1;
+            const std::streampos start = in.tellg();
+            if (start != std::streampos(-1) && in.seekg(0, std::ios::end))
+            {
+                total = (long long)in.tellg();
+                in.seekg(start);
+            }
+            in.clear();
+            for (;;)
+            {
+                char type = 0;
+                if (!in.get(type))
+                    return true;
+                if (type == 0)
+                    continue; // 零填充（内存映射输出的分段未正常关闭时）
+                unsigned long long len = 0;
+                for (unsigned shift = 0;; shift += 7)
+                {
+                    char c = 0;
+                    if (shift >= 64 || !in.get(c))
+                        return false;
+                    len |= (unsigned long long)((unsigned char)c & 0x7f) << shift;
+                    if (!((unsigned char)c & 0x80))
+                        break;
+                }
+                if (total >= 0 && len > (unsigned long long)(total - (long long)in.tellg()))
+                    return false;
+                body.clear();
+                for (size_t got = 0; got < len;)
+                {
+                    const size_t step = (size_t)ml_min<unsigned long long>(len - got, 1u << 20);
+                    body.resize(got + step);
+                    if (!read(&body[got], step))
+                        return false;
+                    got += step;
+                }
+                const char* p = body.data();
+                const char* const end = p + len;
+                auto get = [&](void* v, size_t n)
+                {
+                    if ((size_t)(end - p) < n)
+                        return false;
+                    std::memcpy(v, p, n);
+                    p += n;
+                    return true;
+                };
+                auto getVar = [&](uint32_t& v)
+                {
+                    unsigned long long x = 0;
+                    for (unsigned shift = 0; p < end && shift < 64; shift += 7)
+                    {
+                        const unsigned char c = (unsigned char)*p++;
+                        x |= (unsigned long long)(c & 0x7f) << shift;
+                        if (!(c & 0x80))
+                        {
+                            v = (uint32_t)x;
+                            return true;
+                        }
+                    }
+                    return false;
+                };
+                auto getStr = [&](std::string& v)
+                {
+                    uint32_t n = 0;
+                    if (!getVar(n) || (size_t)(end - p) < n)
+                        return false;
+                    v.assign(p, n);
+                    p += n;
+                    return true;
+                };
+
+                switch (type)
+                {
+                case 'P':
+                {
+                    unsigned char pflags = 0;
+                    if (!get(&pflags, 1) || !getStr(raw))
+                        return false;
+                    if (!fixed)
+                    {
+                        dec.setPattern(raw);
+                        dec._message_only = (pflags & 1) != 0;
+                        dec._json_lines.store((pflags & 2) != 0, std::memory_order_relaxed);
+                    }
+                }
+                break;
+                case 'S':
+                {
+                    uint32_t id = 0;
+                    Site st;
+                    if (!getVar(id) || !getVar(st.line) || !getStr(st.file_short) || !getStr(st.file_full) || !getStr(st.func))
+                        return false;
+                    if (id >= sites.size())
+                        sites.resize(id + 1);
+                    sites[id] = std::move(st);
+                }
+                break;
+                case 'E':
+                case 'I':
+                {
+                    int64_t ts_ns = 0;
+                    unsigned char lv = 0, flags = 0;
+                    uint32_t tid = 0;
+                    Site inl;
+                    const Site* st = &inl;
+                    char fixed_le[8 + 1 + 1 + 4];
+                    if (!get(fixed_le, sizeof(fixed_le)))
+                        return false;
+                    ml_load_le(ts_ns, fixed_le);
+                    lv = (unsigned char)fixed_le[8];
+                    flags = (unsigned char)fixed_le[9];
+                    ml_load_le(tid, fixed_le + 10);
+                    if (type == 'E')
+                    {
+                        uint32_t id = 0;
+                        if (!getVar(id))
+                            return false;
+                        if (id < sites.size())
+                            st = &sites[id];
+                    }
+                    else if (!getVar(inl.line) || !getStr(inl.file_short) || !getStr(inl.file_full) || !getStr(inl.func))
+                        return false;
+                    uint32_t kv_n = 0;
+                    if ((flags & 4) && (!getVar(kv_n) || (size_t)(end - p) < kv_n))
+                        return false;
+                    const size_t body_n = (size_t)(end - p) - kv_n;
+                    recordMessage_(p, body_n, (flags & 2) != 0, msg);
+                    size_t e = msg.size();
+                    while (e > 0 && (msg[e - 1] == '\n' || msg[e - 1] == '\r'))
+                        --e;
+                    line.clear();
+                    const bool terminated = dec.renderRecord_((long long)ts_ns, (Level)lv, st->file_short.c_str(),
+                                                              st->file_full.c_str(), st->func.c_str(), (int)st->line, tid,
+                                                              msg, p + body_n, kv_n, line, pid);
+                    if ((flags & 1) && e == msg.size() && !terminated)
+                        line.push_back('\n');
+                    out.write(line.data(), (std::streamsize)line.size());
+                }
+                break;
+                case 'L':
+                    out.write(p, (std::streamsize)len);
+                    break;
+                default: // 未知记录类型：按长度跳过
+                    break;
+                }
+            }
+        }
+
+        /* ========================= 内置 sink ========================= */
+        // 追加写入独立文件（不参与滚动/按日切换/自愈，这些仍属 logger 自身的日志文件）
+        class ML_FileSink : public ML_Logger::Sink
+        {
+        public:
+            explicit ML_FileSink(const std::string& path, bool autoFlush = true) : _path(path), _auto_flush(autoFlush)
+            {
+                size_t p = path.find_last_of("\\/");
+                if (p != std::string::npos && p > 0)
+                    ML_Logger::platform_createDirectories_(path.substr(0, p));
+                _file.open(path, std::ios::out | std::ios::app | std::ios::binary);
+            }
+            void write(const ML_Logger::Record&, const char* line, size_t n) override
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                if (!_file.is_open())
+                    _file.open(_path, std::ios::out | std::ios::app | std::ios::binary);
+                _file.write(line, n);
+                if (_auto_flush)
+                    _file.flush();
+                if (_file.bad())
+                    _file.close(); // 下一条重开
+            }
+            void flush() override
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                if (_file.is_open())
+                    _file.flush();
+            }
+            const std::string& path() const { return _path; }
+
+        private:
+            std::string _path;
+            bool _auto_flush;
+            std::mutex _mutex;
+            ML_FastOFStream _file;
+        };
+
+        // 控制台（stdout/stderr），与 logger 自身的屏幕输出共用控制台锁；按级别上色仅对终端上的 stdout 生效。
+        // async=true 时交给 ML_AsyncConsole 由后台线程批量 writev，缓冲满时丢弃并计数
+        class ML_ConsoleSink : public ML_Logger::Sink
+        {
+        public:
+            explicit ML_ConsoleSink(bool toStderr = false, bool color = true, bool async = false,
+                                    size_t bufferBytes = 1u << 20)
+                : _stderr(toStderr), _color(color), _async(async)
+            {
+                if (async)
+                {
+                    {
+                        std::lock_guard<std::mutex> g(ML_Logger::console_mutex_());
+                        (toStderr ? std::cerr : std::cout).flush();
+                    }
+                    console_().start(bufferBytes);
+                }
+            }
+            void write(const ML_Logger::Record& rec, const char* line, size_t n) override
+            {
+                const bool colorize = _color && !_stderr && ML_Logger::supportsAnsiColor_();
+                if (_async)
+                {
+                    console_().write(colorize ? ML_Logger::levelColorAnsi_(rec.level) : nullptr, line, n, false,
+                                     colorize ? MLLOG_COLOR_RESET : nullptr);
+                    return;
+                }
+                std::ostream& os = _stderr ? std::cerr : std::cout;
+                std::lock_guard<std::mutex> g(ML_Logger::console_mutex_());
+                if (colorize)
+                    os << ML_Logger::levelColorAnsi_(rec.level);
+                os.write(line, (std::streamsize)n);
+                if (colorize)
+                    os << MLLOG_COLOR_RESET;
+            }
+            void flush() override
+            {
+                if (_async)
+                {
+                    console_().drain();
+                    return;
+                }
+                std::lock_guard<std::mutex> g(ML_Logger::console_mutex_());
+                (_stderr ? std::cerr : std::cout).flush();
+            }
+            size_t droppedCount() const { return _async ? console_().droppedCount() : 0; }
+
+        private:
+            ML_AsyncConsole& console_() const { return _stderr ? ML_AsyncConsole::err() : ML_AsyncConsole::out(); }
+
+            bool _stderr;
+            bool _color;
+            bool _async;
+        };
+
+        // 用户回调（不持有 logger 内部锁，可能被多个线程并发调用）
+        class ML_CallbackSink : public ML_Logger::Sink
+        {
+        public:
+            using Callback = std::function<void(const ML_Logger::Record&, const char*, size_t)>;
+            explicit ML_CallbackSink(Callback cb) : _cb(std::move(cb)) {}
+            void write(const ML_Logger::Record& rec, const char* line, size_t n) override
+            {
+                if (_cb)
+                    _cb(rec, line, n);
+            }
+
+        private:
+            Callback _cb;
+        };
+
+        // 内存环：保留最近 capacity 行（含结尾换行），供崩溃转储/诊断页面读取
+        class ML_MemorySink : public ML_Logger::Sink
+        {
+        public:
+            explicit ML_MemorySink(size_t capacity = 1024) : _cap(ml_max<size_t>(capacity, 1u)), _next(0), _count(0)
+            {
+                _ring.resize(_cap);
+            }
+            void write(const ML_Logger::Record&, const char* line, size_t n) override
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                _ring[_next].assign(line, n); // 槽位容量复用
+                _next = (_next + 1) % _cap;
+                if (_count < _cap)
+                    ++_count;
+            }
+            // 按时间先后返回当前保留的行
+            std::vector<std::string> lines() const
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                std::vector<std::string> out;
+                out.reserve(_count);
+                for (size_t i = 0; i < _count; ++i)
+                    out.push_back(_ring[(_next + _cap - _count + i) % _cap]);
+                return out;
+            }
+            void clear()
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                _next = 0;
+                _count = 0;
+            }
+
+        private:
+            const size_t _cap;
+            size_t _next;
+            size_t _count;
+            std::vector<std::string> _ring;
+            mutable std::mutex _mutex;
+        };
+
+#if !defined(_WIN32)
+        // 网络（POSIX）：UDP 每行一个数据报；TCP 为行流。write() 只把行追加进有界缓冲（满时丢弃并计数），
+        // 解析、连接与发送都在本 sink 的后台线程完成，不阻塞写日志的线程。连接为非阻塞、超时 2 秒，失败后按
+        // 1 秒起、至多 30 秒的间隔退避重连，期间的行计入 droppedCount()。Windows 请用 ML_CallbackSink 接入自己的传输
+        class ML_SocketSink : public ML_Logger::Sink
+        {
+        public:
+            enum class Protocol
+            {
+                Udp,
+                Tcp
+            };
+            ML_SocketSink(const std::string& host, unsigned short port, Protocol proto = Protocol::Udp, size_t queueBytes = 1u << 20)
+                : _host(host), _port(std::to_string(port)), _proto(proto), _cap(ml_max<size_t>(queueBytes, 4096u))
+            {
+                _thread = std::thread([this] { run_(); });
+            }
+            ~ML_SocketSink() override
+            {
+                {
+                    std::lock_guard<std::mutex> lk(_mutex);
+                    _stop = true;
+                }
+                _cv.notify_all();
+                _thread.join(); // 剩余的行尝试发送一次
+                if (_fd >= 0)
+                    ::close(_fd);
+            }
+            ML_SocketSink(const ML_SocketSink&) = delete;
+            ML_SocketSink& operator=(const ML_SocketSink&) = delete;
+
+            void write(const ML_Logger::Record&, const char* line, size_t n) override
+            {
+                {
+                    std::lock_guard<std::mutex> lk(_mutex);
+                    if (_buf.size() + n > _cap)
+                    {
+                        _dropped.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    const bool was_empty = _lens.empty();
+                    _buf.append(line, n);
+                    _lens.push_back(n);
+                    if (!was_empty)
+                        return;
+                }
+                _cv.notify_one();
+            }
+            // 等待已排队的行发出（或因连接不可用被丢弃）
+            void flush() override
+            {
+                std::unique_lock<std::mutex> lk(_mutex);
+                _idle_cv.wait(lk, [this] { return _lens.empty() && !_sending; });
+            }
+            size_t droppedCount() const { return _dropped.load(std::memory_order_relaxed); }
+
+        private:
+            void run_()
+            {
+                std::string batch;
+                std::vector<size_t> lens;
+                for (;;)
+                {
+                    {
+                        std::unique_lock<std::mutex> lk(_mutex);
+                        _cv.wait(lk, [this] { return _stop || !_lens.empty(); });
+                        if (_lens.empty())
+                            return;
+                        batch.swap(_buf);
+                        lens.swap(_lens);
+                        _sending = true;
+                    }
+                    send_(batch, lens);
+                    batch.clear();
+                    lens.clear();
+                    {
+                        std::lock_guard<std::mutex> lk(_mutex);
+                        _sending = false;
+                    }
+                    _idle_cv.notify_all();
+                }
+            }
+
+            void send_(const std::string& b, const std::vector<size_t>& lens)
+            {
+                if (_fd < 0 && !connect_())
+                {
+                    _dropped.fetch_add(lens.size(), std::memory_order_relaxed);
+                    return;
+                }
+                if (_proto == Protocol::Tcp)
+                {
+                    const size_t sent = sendSome_(b.data(), b.size());
+                    if (sent == b.size())
+                        return;
+                    // 行流中途失败：未完整发出的行计为丢弃，断开后重连
+                    size_t end = 0, lost = 0;
+                    for (size_t n : lens)
+                    {
+                        end += n;
+                        if (end > sent)
+                            ++lost;
+                    }
+                    _dropped.fetch_add(lost, std::memory_order_relaxed);
+                    disconnect_();
+                    return;
+                }
+                size_t off = 0;
+                for (size_t i = 0; i < lens.size(); ++i)
+                {
+                    if (_fd < 0)
+                    {
+                        _dropped.fetch_add(lens.size() - i, std::memory_order_relaxed);
+                        return;
+                    }
+                    if (sendSome_(b.data() + off, lens[i]) < lens[i])
+                    {
+                        _dropped.fetch_add(1, std::memory_order_relaxed);
+                        if (errno != EAGAIN && errno != EWOULDBLOCK)
+                            disconnect_();
+                    }
+                    off += lens[i];
+                }
+            }
+
+            // 非阻塞发送：缓冲满时至多等待 1 秒；返回已发出的字节数
+            size_t sendSome_(const char* p, size_t n)
+            {
+#if defined(MSG_NOSIGNAL)
+                const int flags = MSG_NOSIGNAL;
+#else
+                const int flags = 0;
+#endif
+                size_t off = 0;
+                while (off < n)
+                {
+                    const ssize_t w = ::send(_fd, p + off, n - off, flags);
+                    if (w > 0)
+                    {
+                        off += (size_t)w;
+                        continue;
+                    }
+                    if (w < 0 && errno == EINTR)
+                        continue;
+                    if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && waitWritable_(_fd, 1000))
+                        continue;
+                    break;
+                }
+                return off;
+            }
+
+            static bool waitWritable_(int fd, int timeoutMs)
+            {
+                pollfd pfd{fd, POLLOUT, 0};
+                int r;
+                do
+                    r = ::poll(&pfd, 1, timeoutMs);
+                while (r < 0 && errno == EINTR);
+                return r > 0 && (pfd.revents & POLLOUT);
+            }
+
+            void disconnect_()
+            {
+                ::close(_fd);
+                _fd = -1;
+            }
+
+            bool connect_()
+            {
+                const auto now = std::chrono::steady_clock::now();
+                if (now < _next_try)
+                    return false;
+                addrinfo hints{};
+                hints.ai_family = AF_UNSPEC;
+                hints.ai_socktype = (_proto == Protocol::Tcp) ? SOCK_STREAM : SOCK_DGRAM;
+                addrinfo* res = nullptr;
+                if (::getaddrinfo(_host.c_str(), _port.c_str(), &hints, &res) == 0)
+                {
+                    for (addrinfo* ai = res; ai && _fd < 0; ai = ai->ai_next)
+                    {
+                        int fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+                        if (fd < 0)
+                            continue;
+                        (void)::fcntl(fd, F_SETFD, FD_CLOEXEC);
+                        (void)::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+#if defined(SO_NOSIGPIPE)
+                        int one = 1;
+                        (void)::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+                        bool ok = ::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0;
+                        if (!ok && errno == EINPROGRESS && waitWritable_(fd, CONNECT_TIMEOUT_MS))
+                        {
+                            int err = 0;
+                            socklen_t len = sizeof(err);
+                            ok = ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0;
+                        }
+                        if (ok)
+                            _fd = fd;
+                        else
+                            ::close(fd);
+                    }
+                    ::freeaddrinfo(res);
+                }
+                if (_fd >= 0)
+                {
+                    _backoff = std::chrono::milliseconds(1000);
+                    return true;
+                }
+                _next_try = now + _backoff;
+                _backoff = ml_min(_backoff * 2, std::chrono::milliseconds(30000));
+                return false;
+            }
+
+            static const int CONNECT_TIMEOUT_MS = 2000;
+
+            std::string _host;
+            std::string _port;
+            Protocol _proto;
+            const size_t _cap;
+            // 以下由 _mutex 保护
+            std::string _buf;         // 待发送的行（首尾相接）
+            std::vector<size_t> _lens; // 各行长度
+            bool _sending = false;
+            bool _stop = false;
+            std::mutex _mutex;
+            std::condition_variable _cv;
+            std::condition_variable _idle_cv;
+            // 以下只由后台线程访问
+            int _fd = -1;
+            std::chrono::steady_clock::time_point _next_try;
+            std::chrono::milliseconds _backoff{1000};
+            std::atomic<size_t> _dropped{0};
+            std::thread _thread;
+        };
+#endif
+
+        /* ========================= 级别门控（宏使用） ========================= */
+        // 编译期：level 为常量时整个分支被折叠掉
+        constexpr bool mllog_level_active(ML_Logger::Level lv) { return (int)lv >= MLLOG_ACTIVE_LEVEL; }
+
+        // 运行期：在 if 条件中声明，logger 表达式只求值一次；off 为 true 时跳过整条语句
+        struct ML_LogGate
+        {
+            ML_Logger& target;
+            bool off;
+            ML_LogGate(ML_Logger& l, ML_Logger::Level lv) : target(l), off(!l.shouldLog(lv)) {}
+            explicit operator bool() const { return off; }
+        };
+
+        /* ========================= 用户类型格式化钩子 ========================= */
+        // 为自定义类型提供（与类型同命名空间的）void mllog_format(ML_NS::ML_FormatSink&, const T&)，
+        // LoggerStream 即通过 ADL 找到并让其直接追加到日志缓冲，不再经过 ostringstream。
+        class ML_FormatSink
+        {
+        public:
+            template <class Buf>
+            explicit ML_FormatSink(Buf& b) : _target(&b), _append(&appendTo_<Buf>)
+            {
+            }
+
+            void append(const char* s, size_t n) { _append(_target, s, n); }
+            void append(const char* s) { append(s, std::strlen(s)); }
+            void append(const std::string& s) { append(s.data(), s.size()); }
+            void push_back(char c) { append(&c, 1); }
+
+            ML_FormatSink& operator<<(const char* s)
+            {
+                append(s ? s : "nullptr");
+                return *this;
+            }
+            ML_FormatSink& operator<<(const std::string& s)
+            {
+                append(s);
+                return *this;
+            }
+            ML_FormatSink& operator<<(char c)
+            {
+                push_back(c);
+                return *this;
+            }
+            ML_FormatSink& operator<<(bool v)
+            {
+                push_back(v ? '1' : '0');
+                return *this;
+            }
+            template <class T>
+            typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, ML_FormatSink&>::type
+            operator<<(T v)
+            {
+                ml_append_int(*this, (long long)v);
+                return *this;
+            }
+            template <class T>
+            typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, ML_FormatSink&>::type
+            operator<<(T v)
+            {
+                ml_append_uint(*this, (unsigned long long)v);
+                return *this;
+            }
+            ML_FormatSink& operator<<(double v)
+            {
+                ml_append_float(*this, v);
+                return *this;
+            }
+            ML_FormatSink& operator<<(float v)
+            {
+                ml_append_float(*this, v);
+                return *this;
+            }
+
+        private:
+            template <class Buf>
+            static void appendTo_(void* t, const char* s, size_t n) { static_cast<Buf*>(t)->append(s, n); }
+
+            void* _target;
+            void (*_append)(void*, const char*, size_t);
+        };
+
+        // 检测 T 是否提供了 mllog_format 钩子（ADL）
+        template <class T>
+        class ml_has_format_hook
+        {
+            template <class U>
+            static auto test(int) -> decltype(mllog_format(std::declval<ML_FormatSink&>(), std::declval<const U&>()), std::true_type());
+            template <class>
+            static std::false_type test(...);
+
+        public:
+            static const bool value = decltype(test<T>(0))::value;
+        };
+
+        // 无钩子类型的 iostream 回退：每线程复用一个 ostream（只在首次构造、初始化 locale），
+        // 其 streambuf 直接追加到线程私有字符串，不经 ostringstream::str() 拷贝；每次复位格式状态。
+        // operator<< 内部再写日志导致重入时退回临时 ostringstream。
+        class ML_AppendStreamBuf : public std::streambuf
+        {
+        public:
+            std::string text;
+
+        protected:
+            int_type overflow(int_type c) override
+            {
+                if (!traits_type::eq_int_type(c, traits_type::eof()))
+                    text.push_back(traits_type::to_char_type(c));
+                return traits_type::not_eof(c);
+            }
+            std::streamsize xsputn(const char* s, std::streamsize n) override
+            {
+                text.append(s, (size_t)n);
+                return n;
+            }
+        };
+
+        template <class T, class Buf>
+        inline void ml_append_streamed(Buf& out, const T& v)
+        {
+            struct TLS
+            {
+                ML_AppendStreamBuf sb;
+                std::ostream os;
+                bool busy;
+                TLS() : os(&sb), busy(false) {}
+            };
+            thread_local TLS tls;
+            if (tls.busy)
+            {
+                std::ostringstream tmp;
+                tmp << v;
+                const std::string s = tmp.str();
+                out.append(s.data(), s.size());
+                return;
+            }
+            struct BusyGuard // 用户 operator<< 抛异常时也要复位，否则本线程此后一直走回退路径
+            {
+                bool& b;
+                explicit BusyGuard(bool& f) : b(f) { b = true; }
+                ~BusyGuard() { b = false; }
+            } guard(tls.busy);
+            tls.sb.text.clear();
+            tls.os.clear();
+            tls.os.flags(std::ios_base::dec | std::ios_base::skipws);
+            tls.os.precision(6);
+            tls.os.width(0);
+            tls.os.fill(' ');
+            tls.os << v;
+            out.append(tls.sb.text.data(), tls.sb.text.size());
+        }
+
+        /* ========================= {} 风格格式化（MLLOG_*_FMT） ========================= */
+        // 编译期校验（C++11 constexpr，逐字符递归）：花括号配对、{:spec} 的语法、类型字母/精度/符号与对应实参的类别相容
+        // （内置渲染支持的子集，见 ML_FmtSpec），以及占位符与实参一一对应。k 为各实参的类别串（见 ml_fmt_kind_）。
+        // 支持 {} 与 {:spec}、{{ / }} 转义；不支持位置参数 {0} 与嵌套的动态宽度。格式串须为字面量，长度受编译器
+        // constexpr 递归深度限制。
+        constexpr bool ml_fmt_in_(char c, const char* set) { return *set != '\0' && (*set == c || ml_fmt_in_(c, set + 1)); }
+        constexpr bool ml_fmt_align_(char c) { return c == '<' || c == '>' || c == '^'; }
+        constexpr bool ml_fmt_digit_(char c) { return c >= '0' && c <= '9'; }
+        constexpr bool ml_fmt_numeric_(char k) { return k == 'i' || k == 'f'; }
+        constexpr bool ml_fmt_type_ok_(char k, char t)
+        {
+            return k == 'i'   ? ml_fmt_in_(t, "bBcdoxX")
+                   : k == 'f' ? ml_fmt_in_(t, "aAeEfFgG")
+                   : k == 'b' ? ml_fmt_in_(t, "sd")
+                   : k == 'c' ? t == 'c'
+                   : k == 's' ? t == 's'
+                   : k == 'p' ? t == 'p'
+                              : false;
+        }
+        constexpr bool ml_fmt_check_(const char* s, const char* k);
+        constexpr bool ml_fmt_type_(const char* s, const char* k)
+        {
+            return *s == '}' ? ml_fmt_check_(s + 1, k + 1) : s[1] == '}' && ml_fmt_type_ok_(*k, *s) && ml_fmt_check_(s + 2, k + 1);
+        }
+        constexpr bool ml_fmt_prec_(const char* s, const char* k) { return ml_fmt_digit_(*s) ? ml_fmt_prec_(s + 1, k) : ml_fmt_type_(s, k); }
+        constexpr bool ml_fmt_width_(const char* s, const char* k)
+        {
+            return ml_fmt_digit_(*s) ? ml_fmt_width_(s + 1, k)
+                   : *s == '.'      ? (*k == 'f' || *k == 's') && ml_fmt_digit_(s[1]) && ml_fmt_prec_(s + 1, k)
+                                    : ml_fmt_type_(s, k);
+        }
+        constexpr bool ml_fmt_zero_(const char* s, const char* k) { return *s == '0' ? ml_fmt_numeric_(*k) && ml_fmt_width_(s + 1, k) : ml_fmt_width_(s, k); }
+        constexpr bool ml_fmt_alt_(const char* s, const char* k) { return *s == '#' ? ml_fmt_numeric_(*k) && ml_fmt_zero_(s + 1, k) : ml_fmt_zero_(s, k); }
+        constexpr bool ml_fmt_sign_(const char* s, const char* k) { return ml_fmt_in_(*s, "+- ") ? ml_fmt_numeric_(*k) && ml_fmt_alt_(s + 1, k) : ml_fmt_alt_(s, k); }
+        constexpr bool ml_fmt_spec_(const char* s, const char* k)
+        {
+            return *k == 'u'                                                       ? *s == '}' && ml_fmt_check_(s + 1, k + 1) // 自定义类型不带 spec
+                   : *s != '\0' && *s != '{' && *s != '}' && ml_fmt_align_(s[1]) ? ml_fmt_sign_(s + 2, k)
+                   : ml_fmt_align_(*s)                                            ? ml_fmt_sign_(s + 1, k)
+                                                                                  : ml_fmt_sign_(s, k);
+        }
+        constexpr bool ml_fmt_check_(const char* s, const char* k)
+        {
+            return *s == '\0'  ? *k == '\0'
+                   : *s == '{' ? (s[1] == '{' ? ml_fmt_check_(s + 2, k)
+                                  : s[1] == '}' ? *k != '\0' && ml_fmt_check_(s + 2, k + 1)
+                                  : s[1] == ':' ? *k != '\0' && ml_fmt_spec_(s + 2, k)
+                                                : false)
+                   : *s == '}' ? s[1] == '}' && ml_fmt_check_(s + 2, k)
+                               : ml_fmt_check_(s + 1, k);
+        }
+        constexpr bool ml_fmt_check(const char* fmt, const char* kinds) { return ml_fmt_check_(fmt, kinds); }
+
+        // 实参类别：i 整数/枚举 f 浮点 b bool c char s 字符串 p 指针 u 其他（mllog_format 钩子或 operator<<）
+        template <class T>
+        struct ml_fmt_kind_
+        {
+            typedef typename std::decay<T>::type D;
+            static constexpr char value =
+                std::is_same<D, bool>::value                                                      ? 'b'
+                : std::is_same<D, char>::value                                                    ? 'c'
+                : std::is_floating_point<D>::value                                                ? 'f'
+                : std::is_integral<D>::value || std::is_enum<D>::value                            ? 'i'
+                : std::is_same<D, char*>::value || std::is_same<D, const char*>::value ||
+                        std::is_convertible<const D&, const std::string&>::value                  ? 's'
+                : std::is_pointer<D>::value || std::is_same<D, std::nullptr_t>::value             ? 'p'
+                                                                                                  : 'u';
+        };
+        template <class... A>
+        struct ml_fmt_kinds_
+        {
+            static constexpr char value[sizeof...(A) + 1] = {ml_fmt_kind_<A>::value..., '\0'};
+        };
+        template <class... A>
+        constexpr char ml_fmt_kinds_<A...>::value[sizeof...(A) + 1];
+        // 仅用于 decltype（不求值）：由实参表达式得到类别串
+        template <class... A>
+        ml_fmt_kinds_<A...> ml_fmt_kinds_of_(const A&...);
+
+        // 类型擦除的参数（只持有引用/值，生命周期限于一次调用）
+        class ML_FmtArg
+        {
+        public:
+            enum Kind
+            {
+                Int,
+                UInt,
+                Double,
+                Float,
+                Bool,
+                Char,
+                Str,
+                Ptr,
+                Custom
+            };
+            Kind kind;
+            union
+            {
+                long long i;
+                unsigned long long u;
+                double d;
+                float f;
+                bool b;
+                char c;
+                const void* p;
+                struct
+                {
+                    const char* s;
+                    size_t n;
+                } str;
+            };
+            void (*custom)(ML_FormatSink&, const void*);
+
+            ML_FmtArg(bool v) : kind(Bool), custom(nullptr) { b = v; }
+            ML_FmtArg(char v) : kind(Char), custom(nullptr) { c = v; }
+            ML_FmtArg(float v) : kind(Float), custom(nullptr) { f = v; }
+            ML_FmtArg(double v) : kind(Double), custom(nullptr) { d = v; }
+            ML_FmtArg(long double v) : kind(Double), custom(nullptr) { d = (double)v; }
+            ML_FmtArg(const char* v) : kind(Str), custom(nullptr)
+            {
+                str.s = v ? v : "nullptr";
+                str.n = std::strlen(str.s);
+            }
+            ML_FmtArg(char* v) : ML_FmtArg((const char*)v) {}
+            ML_FmtArg(const std::string& v) : kind(Str), custom(nullptr)
+            {
+                str.s = v.data();
+                str.n = v.size();
+            }
+            ML_FmtArg(std::nullptr_t) : kind(Ptr), custom(nullptr) { p = nullptr; }
+            template <class T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value && !std::is_same<T, char>::value, int>::type = 0>
+            ML_FmtArg(T v) : kind(Int), custom(nullptr)
+            {
+                i = (long long)v;
+            }
+            template <class T, typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value, int>::type = 0>
+            ML_FmtArg(T v) : kind(UInt), custom(nullptr)
+            {
+                u = (unsigned long long)v;
+            }
+            template <class T, typename std::enable_if<std::is_enum<T>::value, int>::type = 0>
+            ML_FmtArg(T v) : kind(Int), custom(nullptr)
+            {
+                i = (long long)v;
+            }
+            template <class T>
+            ML_FmtArg(T* v) : kind(Ptr), custom(nullptr)
+            {
+                p = (const void*)v;
+            }
+            template <class T, typename std::enable_if<!std::is_arithmetic<T>::value && !std::is_enum<T>::value && !std::is_pointer<T>::value &&
+                                                           !std::is_convertible<const T&, const std::string&>::value,
+                                                       int>::type = 0>
+            ML_FmtArg(const T& v) : kind(Custom), custom(&customFormat_<T>)
+            {
+                p = &v;
+            }
+
+        private:
+            template <class T>
+            static typename std::enable_if<ml_has_format_hook<T>::value>::type customFormat_(ML_FormatSink& s, const void* v)
+            {
+                mllog_format(s, *static_cast<const T*>(v));
+            }
+            template <class T>
+            static typename std::enable_if<!ml_has_format_hook<T>::value>::type customFormat_(ML_FormatSink& s, const void* v)
+            {
+                ml_append_streamed(s, *static_cast<const T*>(v));
+            }
+        };
+
+        // 类型擦除的参数按 ML_ArgCodec 编码（结构化字段使用）；自定义类型先经钩子/ostream 渲染为文本
+        template <class Buf>
+        inline void ml_encode_arg(Buf& b, const ML_FmtArg& a)
+        {
+            switch (a.kind)
+            {
+            case ML_FmtArg::Int:
+                ML_ArgCodec::put_i64(b, a.i);
+                break;
+            case ML_FmtArg::UInt:
+                ML_ArgCodec::put_u64(b, a.u);
+                break;
+            case ML_FmtArg::Double:
+                ML_ArgCodec::put_f64(b, a.d);
+                break;
+            case ML_FmtArg::Float:
+                ML_ArgCodec::put_f32(b, a.f);
+                break;
+            case ML_FmtArg::Bool:
+                ML_ArgCodec::put_bool(b, a.b);
+                break;
+            case ML_FmtArg::Char:
+                ML_ArgCodec::put_char(b, a.c);
+                break;
+            case ML_FmtArg::Str:
+                ML_ArgCodec::put_str(b, a.str.s, a.str.n);
+                break;
+            case ML_FmtArg::Ptr:
+                ML_ArgCodec::put_ptr(b, a.p);
+                break;
+            case ML_FmtArg::Custom:
+            {
+                ML_SmallBuf<128> text;
+                ML_FormatSink sink(text);
+                a.custom(sink, a.p);
+                ML_ArgCodec::put_str(b, text.data(), text.size());
+            }
+            break;
+            }
+        }
+
+        // 格式说明：[[fill]align][+][#][0][width][.precision][type]，语义同 std::format 的常用子集
+        struct ML_FmtSpec
+        {
+            char fill = ' ';
+            char align = 0; // '<' '>' '^'，0 为默认（数字右对齐，其余左对齐）
+            bool plus = false;
+            bool alt = false;
+            bool zero = false;
+            int width = 0;
+            int prec = -1;
+            char type = 0;
+
+            // s 指向 ':' 之后，解析到 '}' 为止；返回 '}' 之后的位置
+            const char* parse(const char* s)
+            {
+                auto is_align = [](char c)
+                { return c == '<' || c == '>' || c == '^'; };
+                if (s[0] && s[0] != '}' && is_align(s[1]))
+                {
+                    fill = s[0];
+                    align = s[1];
+                    s += 2;
+                }
+                else if (is_align(s[0]))
+                    align = *s++;
+                if (*s == '+')
+                    plus = true, ++s;
+                else if (*s == '-' || *s == ' ')
+                    ++s;
+                if (*s == '#')
+                    alt = true, ++s;
+                if (*s == '0')
+                    zero = true, ++s;
+                while (*s >= '0' && *s <= '9')
+                    width = width * 10 + (*s++ - '0');
+                if (*s == '.')
+                {
+                    ++s;
+                    prec = 0;
+                    while (*s >= '0' && *s <= '9')
+                        prec = prec * 10 + (*s++ - '0');
+                }
+                if (*s && *s != '}')
+                    type = *s++;
+                while (*s && *s != '}')
+                    ++s;
+                return *s ? s + 1 : s;
+            }
+        };
+
+        // 渲染单个参数（不含宽度填充）；numeric 返回是否为数值，用于默认对齐与 0 填充
+        template <class Buf>
+        inline void ml_fmt_render_arg(Buf& out, const ML_FmtArg& a, const ML_FmtSpec& sp, bool& numeric)
+        {
+            numeric = true;
+            char tmp[80];
+            switch (a.kind)
+            {
+            case ML_FmtArg::Int:
+            case ML_FmtArg::UInt:
+            {
+                const bool neg = a.kind == ML_FmtArg::Int && a.i < 0;
+                unsigned long long u = a.kind == ML_FmtArg::Int ? (neg ? 0ULL - (unsigned long long)a.i : (unsigned long long)a.i) : a.u;
+                if (sp.type == 'c')
+                {
+                    numeric = false;
+                    out.push_back((char)u);
+                    return;
+                }
+                if (neg)
+                    out.push_back('-');
+                else if (sp.plus)
+                    out.push_back('+');
+                unsigned base = 10;
+                const char* digits = "0123456789abcdef";
+                if (sp.type == 'x' || sp.type == 'X')
+                    base = 16;
+                else if (sp.type == 'b' || sp.type == 'B')
+                    base = 2;
+                else if (sp.type == 'o')
+                    base = 8;
+                if (sp.type == 'X')
+                    digits = "0123456789ABCDEF";
+                if (base == 10)
+                {
+                    ml_append_uint(out, u);
+                    return;
+                }
+                if (sp.alt && base != 8)
+                {
+                    out.push_back('0');
+                    out.push_back(sp.type);
+                }
+                else if (sp.alt && u != 0)
+                    out.push_back('0');
+                char* e = tmp + sizeof(tmp);
+                char* p = e;
+                do
+                {
+                    *--p = digits[u % base];
+                    u /= base;
+                } while (u);
+                out.append(p, (size_t)(e - p));
+                return;
             }
-
-            void renderPattern_(const std::tm& tmv, int ms, Level lv,
-                                const char* file_short, const char* file_full, const char* func, int line,
-                                const std::string& msg, std::string& out) const
+            case ML_FmtArg::Double:
+            case ML_FmtArg::Float:
             {
-                const char* level_str = levelToStringC_(lv);
+                const double v = a.kind == ML_FmtArg::Float ? (double)a.f : a.d;
+                if (sp.plus && !(v < 0))
+                    out.push_back('+');
+                if (sp.type == 0 && sp.prec < 0)
+                {
+                    if (a.kind == ML_FmtArg::Float)
+                        ml_append_float(out, a.f);
+                    else
+                        ml_append_float(out, v);
+                    return;
+                }
+                char conv = sp.type ? sp.type : 'g';
+                if (conv != 'f' && conv != 'F' && conv != 'e' && conv != 'E' && conv != 'g' && conv != 'G' && conv != 'a' && conv != 'A')
+                    conv = 'g';
+                const int prec = sp.prec >= 0 ? sp.prec : 6;
+                char f[8];
+                int k = 0;
+                f[k++] = '%';
+                if (sp.alt)
+                    f[k++] = '#';
+                f[k++] = '.';
+                f[k++] = '*';
+                f[k++] = conv;
+                f[k] = '\0';
 #if defined(_WIN32)
-                const unsigned pid = GetCurrentProcessId();
+                int n = _snprintf(tmp, (unsigned)sizeof(tmp), f, prec, v);
 #else
-                const unsigned pid = (unsigned)getpid();
+                int n = std::snprintf(tmp, sizeof(tmp), f, prec, v);
 #endif
-                const unsigned tid = (unsigned)std::hash<std::thread::id>{}(std::this_thread::get_id());
-
-                for (const auto& op : _pat_ops)
+                if (n > 0)
+                    out.append(tmp, (size_t)n < sizeof(tmp) ? (size_t)n : sizeof(tmp) - 1);
+                return;
+            }
+            case ML_FmtArg::Bool:
+                numeric = false;
+                if (sp.type == 'd')
+                    out.push_back(a.b ? '1' : '0');
+                else if (a.b)
+                    out.append("true", 4);
+                else
+                    out.append("false", 5);
+                return;
+            case ML_FmtArg::Char:
+                numeric = false;
+                out.push_back(a.c);
+                return;
+            case ML_FmtArg::Str:
+                numeric = false;
+                out.append(a.str.s, sp.prec >= 0 && (size_t)sp.prec < a.str.n ? (size_t)sp.prec : a.str.n);
+                return;
+            case ML_FmtArg::Ptr:
+            {
+                numeric = false;
+                uintptr_t v = (uintptr_t)a.p;
+                char* e = tmp + sizeof(tmp);
+                char* p = e;
+                do
                 {
-                    switch (op.type)
-                    {
-                    case PatType::Lit:
-                        out.append(op.text);
-                        break;
-                    case PatType::LevelShort:
-                    case PatType::LevelLong:
-                        out.append(level_str);
-                        break;
-                    case PatType::LoggerName:
-                        out.append(_name);
-                        break;
-                    case PatType::PID:
-                    {
-                        char b[32];
-                        int n = std::snprintf(b, sizeof(b), "%u", pid);
-                        if (n > 0)
-                            out.append(b, n);
-                    }
-                    break;
-                    case PatType::TID:
-                    {
-                        char b[32];
-                        int n = std::snprintf(b, sizeof(b), "%u", tid);
-                        if (n > 0)
-                            out.append(b, n);
-                    }
-                    break;
-                    case PatType::FileShort:
-                        out.append(file_short ? file_short : "?");
-                        break;
-                    case PatType::FileFull:
-                        out.append(file_full ? file_full : "?");
-                        break;
-                    case PatType::Line:
-                    {
-                        char b[16];
-                        int n = std::snprintf(b, sizeof(b), "%d", line);
-                        if (n > 0)
-                            out.append(b, n);
-                    }
-                    break;
-                    case PatType::Func:
-                        out.append(func ? func : "?");
-                        break;
-                    case PatType::Message:
-                        out.append(msg);
-                        break;
-                    case PatType::Ms:
-                    {
-                        char b[8];
-                        int n = std::snprintf(b, sizeof(b), "%03d", ms);
-                        if (n > 0)
-                            out.append(b, n);
-                    }
-                    break;
-                    case PatType::DateChunk:
-                    {
-                        // 处理 %e（毫秒）占位：先把 %e 替换为 @@@ ，strftime 后再二次替换为真正数值
-                        std::string tmp;
-                        tmp.reserve(op.text.size() + 8);
-                        for (size_t i = 0; i < op.text.size(); ++i)
-                        {
-                            if (op.text[i] == '%' && i + 1 < op.text.size() && op.text[i + 1] == 'e')
-                            {
-                                tmp += "@@@";
-                                ++i;
-                            }
-                            else
-                                tmp.push_back(op.text[i]);
-                        }
-                        size_t cap = 128;
-                        std::string buf(cap, '\0');
-                        size_t n = 0;
-                        for (;;)
-                        {
-                            n = std::strftime(&buf[0], buf.size(), tmp.c_str(), &tmv);
-                            if (n > 0)
-                                break;
-                            cap <<= 1;
-                            if (cap > 4096)
-                                break; // 安全上限
-                            buf.assign(cap, '\0');
-                        }
-                        if (n > 0)
-                        {
-                            std::string t2;
-                            t2.reserve(n + 4);
-                            for (size_t j = 0; j < n;)
-                            {
-                                if (j + 3 <= n && std::memcmp(buf.data() + j, "@@@", 3) == 0)
-                                {
-                                    char b[8];
-                                    int k = std::snprintf(b, sizeof(b), "%03d", ms);
-                                    if (k > 0)
-                                        t2.append(b, k);
-                                    j += 3;
-                                }
-                                else
-                                {
-                                    t2.push_back(buf[j++]);
-                                }
-                            }
-                            out.append(t2);
-                        }
-                    }
-                    break;
-                    case PatType::ColorStart:
-                    case PatType::ColorStop:
-                        // 忽略（仍采用整行按级别上色，不污染文件）
-                        break;
-                    }
-                }
+                    *--p = "0123456789abcdef"[v & 15u];
+                    v >>= 4;
+                } while (v);
+                out.append("0x", 2);
+                out.append(p, (size_t)(e - p));
+                return;
             }
-            void maybeHealUnlinked_()
+            case ML_FmtArg::Custom:
             {
-#if defined(_WIN32)
-                (void)0;
-#else
-                if (_heal_every <= 0 || !_outputToFile || !_file.is_open() || _curFilePath.empty())
-                    return;
-                if (++_heal_counter < _heal_every)
-                    return;
-                _heal_counter = 0;
+                numeric = false;
+                ML_FormatSink sink(out);
+                a.custom(sink, a.p);
+                return;
+            }
+            }
+        }
 
-                // 先取“路径是否存在 + inode 是否匹配”
-                bool need_reopen = false;
-                struct stat st_path{};
-                if (::stat(_curFilePath.c_str(), &st_path) != 0)
+        // 按格式串把参数渲染进 out；格式串已在编译期校验过，这里遇到异常写法只做尽力输出
+        template <class Buf>
+        inline void ml_fmt_format_to(Buf& out, const char* fmt, const ML_FmtArg* args, size_t nargs)
+        {
+            size_t next = 0;
+            const char* lit = fmt;
+            const char* s = fmt;
+            while (*s)
+            {
+                if ((s[0] == '{' && s[1] == '{') || (s[0] == '}' && s[1] == '}'))
                 {
-                    // 路径不存在（被 unlink）
-                    need_reopen = true;
+                    out.append(lit, (size_t)(s - lit) + 1);
+                    s += 2;
+                    lit = s;
+                    continue;
+                }
+                if (s[0] != '{')
+                {
+                    ++s;
+                    continue;
                 }
+                out.append(lit, (size_t)(s - lit));
+                ML_FmtSpec sp;
+                if (s[1] == ':')
+                    s = sp.parse(s + 2);
                 else
                 {
-                    int fd = _file.native_fileno(); // <== 需要补丁 A
-                    if (fd >= 0)
-                    {
-                        struct stat st_fd{};
-                        if (::fstat(fd, &st_fd) == 0)
-                        {
-                            // dev/inode 变化 => 我们拿的是“旧文件”，路径上是“新文件”
-                            if (st_fd.st_dev != st_path.st_dev || st_fd.st_ino != st_path.st_ino)
-                                need_reopen = true;
-                        }
-                    }
+                    s += 1;
+                    while (*s && *s != '}')
+                        ++s;
+                    if (*s)
+                        ++s;
                 }
-
-                if (need_reopen)
+                lit = s;
+                if (next >= nargs)
+                    continue;
+                const ML_FmtArg& a = args[next++];
+                bool numeric = true;
+                if (sp.width <= 0)
                 {
-                    _file.close();
-                    _file.open(_curFilePath, std::ios::out | std::ios::app | std::ios::binary);
-                    if (_file.is_open())
-                    {
-                        _file.seekp(0, std::ios::end);
-                        std::streampos pos = _file.tellp();
-                        _currentSize = (pos >= 0) ? (size_t)pos : 0u;
-                    }
-                    else
-                    {
-                        reportError_(std::string("Heal reopen failed: ") + _curFilePath);
-                        _initialized = false; // 让后续写入触发 rollFiles_()
-                    }
+                    ml_fmt_render_arg(out, a, sp, numeric);
+                    continue;
                 }
-#endif
-            }
-
-        private:
-            ML_FastOFStream _file;
-            std::mutex _mutex;
-            std::string _name; // [NEW] 实例名（%n）
-            std::string _baseName;
-            std::string _baseNameWithoutPath;
-            std::string _baseFullNameWithDateAndTime;
-            bool _isRoll;
-            Level _logLevel;
-            bool _outputToFile;
-            bool _outputToScreen;
-            int _currentRollIndex;
-            int _maxRolls;
-            size_t _maxSizeInBytes;
-            size_t _currentSize;
-            bool _initialized;
-            bool _message_only;
-            bool _add_newline;
-            bool _log_enabled;
-            bool _log_screen_color;
-            bool _default_file_name_day;
-            bool _isCheckDay;
-            std::string _start_timestamp;
-            std::atomic<int> _last_log_ymd;
-            bool _auto_flush;
-            std::atomic<bool> _need_day_switch;
-            ErrorHandler _error_handler;
-            static constexpr size_t PENDING_MAX_BYTES = 4u * 1024u * 1024u;
-            static constexpr size_t PENDING_MAX_COUNT = 2000u;
-            std::deque<std::string> _pending;
-            size_t _pending_bytes;
-            std::atomic<int> _phase;
-
-            // Pattern 状态
-            std::string _pattern_raw;    // [NEW]
-            std::vector<PatOp> _pat_ops; // [NEW]
-            std::atomic<bool> _has_pattern{false};
-
-            std::string _curFilePath; // 当前打开并写入的文件完整路径
-            int _heal_every = 256;    // 每写多少行做一次自愈检查（0=关闭）
-            int _heal_counter = 0;    // 计数器
-
-            static bool& in_logging_flag_()
-            {
-                thread_local bool flag = false;
-                return flag;
+                ML_SmallBuf<128> field;
+                ml_fmt_render_arg(field, a, sp, numeric);
+                const size_t len = field.size();
+                const size_t pad = (size_t)sp.width > len ? (size_t)sp.width - len : 0;
+                const char align = sp.align ? sp.align : (numeric ? '>' : '<');
+                if (pad && numeric && sp.zero && !sp.align)
+                {
+                    // 0 填充放在符号/进制前缀之后
+                    size_t pre = 0;
+                    const char* f = field.data();
+                    if (pre < len && (f[pre] == '-' || f[pre] == '+'))
+                        ++pre;
+                    if (pre + 1 < len && f[pre] == '0' && (f[pre + 1] == 'x' || f[pre + 1] == 'X' || f[pre + 1] == 'b' || f[pre + 1] == 'B'))
+                        pre += 2;
+                    out.append(f, pre);
+                    for (size_t k = 0; k < pad; ++k)
+                        out.push_back('0');
+                    out.append(f + pre, len - pre);
+                    continue;
+                }
+                const size_t left = align == '>' ? pad : align == '^' ? pad / 2 : 0;
+                for (size_t k = 0; k < left; ++k)
+                    out.push_back(sp.fill);
+                out.append(field.data(), len);
+                for (size_t k = left; k < pad; ++k)
+                    out.push_back(sp.fill);
             }
-        };
+            out.append(lit, (size_t)(s - lit));
+        }
 
-        /* =================== Registry 方法定义 =================== */
-        inline ML_LoggerRegistry& ML_LoggerRegistry::getInstance()
+#if MLLOG_HAS_STD_FORMAT
+        // 标准库路径：格式串由 std::format_string 在编译期校验，直接 format_to 到线程私有缓冲
+        template <class... A>
+        inline void ml_logfmt(ML_Logger& lg, const ML_Logger::CallSite* site, ML_Logger::Level lv,
+                              std::format_string<A...> fmt, A&&... a)
         {
-            static ML_LoggerRegistry* p = new ML_LoggerRegistry(); // 永不析构
-            return *p;
+            thread_local std::string buf;
+            buf.clear();
+            std::format_to(std::back_inserter(buf), fmt, std::forward<A>(a)...);
+            lg.log(site, lv, buf.data(), buf.size(), lg.getAddNewLine());
         }
-        inline ML_Logger& ML_LoggerRegistry::get(const std::string& name)
+#else
+        // 内置路径：格式串已由宏里的 static_assert 校验，参数类型擦除后渲染到栈缓冲
+        template <class... A>
+        inline void ml_logfmt(ML_Logger& lg, const ML_Logger::CallSite* site, ML_Logger::Level lv,
+                              const char* fmt, const A&... a)
         {
-            std::lock_guard<std::mutex> lock(_mutex);
-            auto it = _loggers.find(name);
-            if (it == _loggers.end())
-                it = _loggers.emplace(name, std::unique_ptr<ML_Logger>(new ML_Logger(name))).first; // [CHG]
-            return *it->second;
+            const ML_FmtArg args[] = {ML_FmtArg(a)..., ML_FmtArg(0)};
+            ML_SmallBuf<512> buf;
+            ml_fmt_format_to(buf, fmt, args, sizeof...(A));
+            lg.log(site, lv, buf.data(), buf.size(), lg.getAddNewLine());
         }
-        inline ML_LoggerRegistry::~ML_LoggerRegistry() = default;
+#endif
 
         /* ========================= 日志流（携带 短/全文件+函数） ========================= */
         class LoggerStream
@@ -2206,52 +7821,85 @@ namespace mllog_v292
         public:
             LoggerStream(ML_Logger& logger, ML_Logger::Level lv,
                          const char* file_short, const char* file_full, const char* func, int line)
-                : _logger(logger), _lv(lv), _file_short(file_short), _file_full(file_full), _func(func), _line(line)
+                : _logger(logger), _lv(lv), _site(nullptr), _file_short(file_short), _file_full(file_full), _func(func), _line(line),
+                  _deferred(logger.getDeferredFormat())
+            {
+            }
+            // 宏使用：调用点信息来自 static 描述符
+            LoggerStream(ML_Logger& logger, const ML_Logger::CallSite* site, ML_Logger::Level lv)
+                : _logger(logger), _lv(lv), _site(site), _file_short(nullptr), _file_full(nullptr), _func(nullptr), _line(0),
+                  _deferred(logger.getDeferredFormat())
+            {
+            }
+
+            ~LoggerStream()
             {
-                if (_buf.capacity() < 256)
-                    _buf.reserve(256);
-                _buf.clear();
+                const bool nl = _logger.getAddNewLine();
+                // 字段编码紧随正文存放，异步入队/二进制编码时无需再拼接
+                const size_t body_n = _buf.size();
+                const size_t kv_n = _kv.size();
+                if (kv_n)
+                    _buf.append(_kv.data(), kv_n);
+                const char* kv = _buf.data() + body_n;
+                if (_site)
+                {
+                    if (_deferred)
+                        _logger.logDeferred(_site, _lv, _buf.data(), body_n, nl, kv, kv_n);
+                    else
+                        _logger.log(_site, _lv, _buf.data(), body_n, nl, kv, kv_n);
+                }
+                else if (_deferred)
+                    _logger.logDeferred(_file_short, _file_full, _func, _line, _lv, _buf.data(), body_n, nl, kv, kv_n);
+                else
+                    _logger.log(_file_short, _file_full, _func, _line, _lv, _buf.data(), body_n, nl, kv, kv_n);
             }
 
-            ~LoggerStream() { _logger.log(_file_short, _file_full, _func, _line, _lv, _buf, _logger.getAddNewLine()); }
+            // 结构化字段：MLLOG_INFO.kv("user", uid).kv("latency_us", lat) << "request done"。
+            // 值按类型编码、与正文分开存放（不拼进正文），由输出端渲染：文本为 logfmt（key=value），二进制文件保留类型
+            template <class T>
+            LoggerStream& kv(const char* key, const T& value)
+            {
+                ML_ArgCodec::put_str(_kv, key, std::strlen(key));
+                ml_encode_arg(_kv, ML_FmtArg(value));
+                return *this;
+            }
 
             LoggerStream& operator<<(const std::string& s)
             {
-                _buf.append(s);
+                append_str(s.data(), s.size());
                 return *this;
             }
             LoggerStream& operator<<(const char* s)
             {
-                _buf.append(s ? s : "nullptr");
+                if (!s)
+                    s = "nullptr";
+                append_str(s, std::strlen(s));
                 return *this;
             }
             LoggerStream& operator<<(char c)
             {
-                _buf.push_back(c);
+                if (_deferred)
+                    ML_ArgCodec::put_char(_buf, c);
+                else
+                    _buf.push_back(c);
                 return *this;
             }
 
             template <class T>
             LoggerStream& operator<<(T* p)
             {
-                if (!p)
-                {
-                    _buf.append("nullptr");
-                    return *this;
-                }
-                char tmp[32];
-#if defined(_WIN32)
-                int n = _snprintf(tmp, (unsigned)sizeof(tmp), "%p", (const void*)p);
-#else
-                int n = std::snprintf(tmp, sizeof(tmp), "%p", (const void*)p);
-#endif
-                if (n > 0)
-                    _buf.append(tmp, (size_t)n);
+                if (_deferred)
+                    ML_ArgCodec::put_ptr(_buf, (const void*)p);
+                else
+                    ml_append_ptr(_buf, (const void*)p);
                 return *this;
             }
             LoggerStream& operator<<(bool v)
             {
-                _buf.push_back(v ? '1' : '0');
+                if (_deferred)
+                    ML_ArgCodec::put_bool(_buf, v);
+                else
+                    _buf.push_back(v ? '1' : '0');
                 return *this;
             }
             LoggerStream& operator<<(short v)
@@ -2296,7 +7944,10 @@ namespace mllog_v292
             }
             LoggerStream& operator<<(float v)
             {
-                append_float((double)v);
+                if (_deferred)
+                    ML_ArgCodec::put_f32(_buf, v);
+                else
+                    ml_append_float(_buf, v, _prec);
                 return *this;
             }
             LoggerStream& operator<<(double v)
@@ -2309,65 +7960,115 @@ namespace mllog_v292
                 append_float((double)v);
                 return *this;
             }
+            LoggerStream& operator<<(ML_Precision p)
+            {
+                _prec = p.digits < 0 ? -1 : p.digits;
+                if (_deferred)
+                    ML_ArgCodec::put_prec(_buf, _prec);
+                return *this;
+            }
+            template <class T>
+            typename std::enable_if<ml_has_format_hook<T>::value, LoggerStream&>::type operator<<(const T& v)
+            {
+                if (_deferred)
+                {
+                    // 延迟模式下用户类型须在调用线程渲染（对象可能随后失效），结果按字符串入编码
+                    thread_local std::string scratch;
+                    scratch.clear();
+                    ML_FormatSink sink(scratch);
+                    mllog_format(sink, v);
+                    ML_ArgCodec::put_str(_buf, scratch.data(), scratch.size());
+                }
+                else
+                {
+                    ML_FormatSink sink(_buf);
+                    mllog_format(sink, v);
+                }
+                return *this;
+            }
             template <class T>
-            LoggerStream& operator<<(const T& v)
+            typename std::enable_if<!ml_has_format_hook<T>::value, LoggerStream&>::type operator<<(const T& v)
             {
-                std::ostringstream oss;
-                oss << v;
-                _buf.append(oss.str());
+                if (_deferred)
+                {
+                    thread_local std::string scratch;
+                    scratch.clear();
+                    ml_append_streamed(scratch, v);
+                    ML_ArgCodec::put_str(_buf, scratch.data(), scratch.size());
+                }
+                else
+                    ml_append_streamed(_buf, v);
                 return *this;
             }
 
         private:
-            static inline void append_int_to(std::string& out, long long v)
+            // 延迟模式下只做二进制编码（memcpy），文本渲染交给写线程
+            inline void append_str(const char* s, size_t n)
             {
-                char tmp[32];
-#if defined(_WIN32)
-                int n = _snprintf(tmp, (unsigned)sizeof(tmp), "%lld", v);
-#else
-                int n = std::snprintf(tmp, sizeof(tmp), "%lld", (long long)v);
-#endif
-                if (n > 0)
-                    out.append(tmp, (size_t)n);
+                if (_deferred)
+                    ML_ArgCodec::put_str(_buf, s, n);
+                else
+                    _buf.append(s, n);
             }
-            static inline void append_uint_to(std::string& out, unsigned long long v)
+            inline void append_int(long long v)
             {
-                char tmp[32];
-#if defined(_WIN32)
-                int n = _snprintf(tmp, (unsigned)sizeof(tmp), "%llu", v);
-#else
-                int n = std::snprintf(tmp, sizeof(tmp), "%llu", (unsigned long long)v);
-#endif
-                if (n > 0)
-                    out.append(tmp, (size_t)n);
+                if (_deferred)
+                    ML_ArgCodec::put_i64(_buf, v);
+                else
+                    ml_append_int(_buf, v);
             }
-            static inline void append_float_to(std::string& out, double v)
+            inline void append_uint(unsigned long long v)
             {
-                char tmp[64];
-#if defined(_WIN32)
-                int n = _snprintf(tmp, (unsigned)sizeof(tmp), "%.6g", v);
-#else
-                int n = std::snprintf(tmp, sizeof(tmp), "%.6g", v);
-#endif
-                if (n > 0)
-                    out.append(tmp, (size_t)n);
+                if (_deferred)
+                    ML_ArgCodec::put_u64(_buf, v);
+                else
+                    ml_append_uint(_buf, v);
+            }
+            inline void append_float(double v)
+            {
+                if (_deferred)
+                    ML_ArgCodec::put_f64(_buf, v);
+                else
+                    ml_append_float(_buf, v, _prec);
             }
-            inline void append_int(long long v) { append_int_to(_buf, v); }
-            inline void append_uint(unsigned long long v) { append_uint_to(_buf, v); }
-            inline void append_float(double v) { append_float_to(_buf, v); }
 
         private:
             ML_Logger& _logger;
             ML_Logger::Level _lv;
+            const ML_Logger::CallSite* _site;
             const char* _file_short;
             const char* _file_full; // [NEW]
             const char* _func;      // [NEW]
             int _line;
-            std::string _buf;
+            bool _deferred; // 构造时确定：true 则 _buf 存放参数编码而非文本
+            int _prec = -1; // 浮点有效位数，-1 为最短往返
+            ML_SmallBuf<512> _buf; // 常见短日志全程在栈上，超长才分配
+            ML_SmallBuf<128> _kv;  // 结构化字段编码（键、值交替）
         };
     } // inline namespace v2_9_2
 } // namespace mllog_v292
 
+#if MLLOG_HAS_STD_FORMAT
+// std::format 路径下，提供了 mllog_format 钩子的类型同样可用于 MLLOG_*_FMT
+namespace std
+{
+    template <class T>
+        requires(::mllog_v292::v2_9_2::ml_has_format_hook<T>::value)
+    struct formatter<T, char>
+    {
+        constexpr auto parse(std::format_parse_context& ctx) { return ctx.begin(); }
+        template <class Ctx>
+        auto format(const T& v, Ctx& ctx) const
+        {
+            std::string s;
+            ::mllog_v292::v2_9_2::ML_FormatSink sink(s);
+            mllog_format(sink, v);
+            return std::copy(s.begin(), s.end(), ctx.out());
+        }
+    };
+} // namespace std
+#endif
+
 #if !defined(_WIN32)
 #pragma GCC visibility pop
 #endif
@@ -2383,12 +8084,34 @@ namespace mllog_v292
 #define MLFILE_FULL __FILE__
 #define MLFUNC __func__
 
-#define MLLOG_STREAM(logger, level) ML_NS::LoggerStream(logger, level, MLFILE_SHORT, MLFILE_FULL, MLFUNC, __LINE__)
-
-#define MLLOGF_FORMAT(logger, level, fmt, ...)                                                      \
-    do                                                                                              \
-    {                                                                                               \
-        (logger).logformat(MLFILE_SHORT, MLFILE_FULL, MLFUNC, __LINE__, level, fmt, ##__VA_ARGS__); \
+// 每个调用点一个 static const 描述符（首次执行时构造），之后只传指针。
+// __func__ 须在宏展开处求值（lambda 内部的 __func__ 是 operator()），故作为参数传入。
+#define MLLOG_CALLSITE(level, fmt)                                                             \
+    ([](const char* mllog_func_, ML_NS::ML_Logger::Level mllog_lv_, const char* mllog_fmt_) \
+         -> const ML_NS::ML_Logger::CallSite* {                                               \
+        static const ML_NS::ML_Logger::CallSite mllog_site_(                                   \
+            MLFILE_SHORT, MLFILE_FULL, mllog_func_, __LINE__, mllog_lv_, mllog_fmt_);          \
+        return &mllog_site_;                                                                   \
+    }(MLFUNC, level, fmt))
+
+// if/else 形式：级别关闭时 << 右侧的操作数不求值；用户代码里的 else 仍与用户自己的 if 配对。
+#define MLLOG_STREAM(logger, level)                                                  \
+    if (!ML_NS::mllog_level_active(level))                                           \
+        ;                                                                            \
+    else if (ML_NS::ML_LogGate mllog_gate_ = ML_NS::ML_LogGate((logger), (level)))  \
+        ;                                                                            \
+    else                                                                             \
+        ML_NS::LoggerStream(mllog_gate_.target, MLLOG_CALLSITE(level, nullptr), level)
+
+#define MLLOGF_FORMAT(logger, level, fmt, ...)                                                       \
+    do                                                                                               \
+    {                                                                                                \
+        if (ML_NS::mllog_level_active(level))                                                        \
+        {                                                                                            \
+            ML_NS::ML_Logger& mllog_logger_ = (logger);                                              \
+            if (mllog_logger_.shouldLog(level))                                                      \
+                mllog_logger_.logformat(MLLOG_CALLSITE(level, fmt), level, fmt, ##__VA_ARGS__);      \
+        }                                                                                            \
     } while (0)
 
 /* 默认 logger ("default") */
@@ -2440,6 +8163,37 @@ namespace mllog_v292
 #define MLLOG_CRITICALF(fmt, ...) MLLOGF(ML_NS::ML_Logger::Level::Critical, fmt, ##__VA_ARGS__)
 #define MLLOG_ALERTF(fmt, ...) MLLOGF(ML_NS::ML_Logger::Level::Alert, fmt, ##__VA_ARGS__)
 
+/* {} 风格：MLLOG_INFO_FMT("order {} filled at {:.4f}", id, px)；格式串须为字面量，编译期校验 */
+#if MLLOG_HAS_STD_FORMAT
+#define MLLOG_FMT_CHECK_(fmt, ...) ((void)0)
+#else
+#define MLLOG_FMT_CHECK_(fmt, ...)                                                                                     \
+    static_assert(ML_NS::ml_fmt_check(fmt, decltype(ML_NS::ml_fmt_kinds_of_(__VA_ARGS__))::value),                    \
+                  "MLLOG_*_FMT: malformed format string, a spec that does not fit its argument type, or placeholder count " \
+                  "does not match the arguments")
+#endif
+
+#define MLLOGFMT_FORMAT(logger, level, fmt, ...)                                                         \
+    do                                                                                                   \
+    {                                                                                                    \
+        MLLOG_FMT_CHECK_(fmt, ##__VA_ARGS__);                                                            \
+        if (ML_NS::mllog_level_active(level))                                                            \
+        {                                                                                                \
+            ML_NS::ML_Logger& mllog_logger_ = (logger);                                                  \
+            if (mllog_logger_.shouldLog(level))                                                          \
+                ML_NS::ml_logfmt(mllog_logger_, MLLOG_CALLSITE(level, fmt), level, fmt, ##__VA_ARGS__); \
+        }                                                                                                \
+    } while (0)
+
+#define MLLOG_FMT(level, fmt, ...) MLLOGFMT_FORMAT(ML_NS::ML_Logger::get(), level, fmt, ##__VA_ARGS__)
+#define MLLOG_DEBUG_FMT(fmt, ...) MLLOG_FMT(ML_NS::ML_Logger::Level::Debug, fmt, ##__VA_ARGS__)
+#define MLLOG_INFO_FMT(fmt, ...) MLLOG_FMT(ML_NS::ML_Logger::Level::Info, fmt, ##__VA_ARGS__)
+#define MLLOG_NOTICE_FMT(fmt, ...) MLLOG_FMT(ML_NS::ML_Logger::Level::Notice, fmt, ##__VA_ARGS__)
+#define MLLOG_WARNING_FMT(fmt, ...) MLLOG_FMT(ML_NS::ML_Logger::Level::Warning, fmt, ##__VA_ARGS__)
+#define MLLOG_ERROR_FMT(fmt, ...) MLLOG_FMT(ML_NS::ML_Logger::Level::Error, fmt, ##__VA_ARGS__)
+#define MLLOG_CRITICAL_FMT(fmt, ...) MLLOG_FMT(ML_NS::ML_Logger::Level::Critical, fmt, ##__VA_ARGS__)
+#define MLLOG_ALERT_FMT(fmt, ...) MLLOG_FMT(ML_NS::ML_Logger::Level::Alert, fmt, ##__VA_ARGS__)
+
 /* 命名实例 */
 #define MLLOG_START_NAMED(name)                          \
     do                                                   \
@@ -2457,7 +8211,14 @@ namespace mllog_v292
         ML_NS::ML_Logger::get(name).flush(); \
     } while (0)
 
-#define MLLOG_NAMED(name, level) MLLOG_STREAM(ML_NS::ML_Logger::get(name), level)
+// 每个调用点一个 logger 指针缓存（常量初始化，无守卫）；name 可为字面量、const char* 或 std::string
+#define MLLOG_NAMED_LOGGER(name)                                                   \
+    ML_NS::ML_Logger::getCached([]() -> std::atomic<ML_NS::ML_Logger*>& {          \
+        static std::atomic<ML_NS::ML_Logger*> mllog_slot_{nullptr};                \
+        return mllog_slot_;                                                        \
+    }(), name)
+
+#define MLLOG_NAMED(name, level) MLLOG_STREAM(MLLOG_NAMED_LOGGER(name), level)
 #define MLLOG_DEBUG_NAMED(name) MLLOG_NAMED(name, ML_NS::ML_Logger::Level::Debug)
 #define MLLOG_INFO_NAMED(name) MLLOG_NAMED(name, ML_NS::ML_Logger::Level::Info)
 #define MLLOG_NOTICE_NAMED(name) MLLOG_NAMED(name, ML_NS::ML_Logger::Level::Notice)
@@ -2466,11 +8227,7 @@ namespace mllog_v292
 #define MLLOG_CRITICAL_NAMED(name) MLLOG_NAMED(name, ML_NS::ML_Logger::Level::Critical)
 #define MLLOG_ALERT_NAMED(name) MLLOG_NAMED(name, ML_NS::ML_Logger::Level::Alert)
 
-#define MLLOGF_NAMED(name, level, fmt, ...)                                                                            \
-    do                                                                                                                 \
-    {                                                                                                                  \
-        ML_NS::ML_Logger::get(name).logformat(MLFILE_SHORT, MLFILE_FULL, MLFUNC, __LINE__, level, fmt, ##__VA_ARGS__); \
-    } while (0)
+#define MLLOGF_NAMED(name, level, fmt, ...) MLLOGF_FORMAT(MLLOG_NAMED_LOGGER(name), level, fmt, ##__VA_ARGS__)
 
 #define MLLOG_DEBUGF_NAMED(name, fmt, ...) MLLOGF_NAMED(name, ML_NS::ML_Logger::Level::Debug, fmt, ##__VA_ARGS__)
 #define MLLOG_INFOF_NAMED(name, fmt, ...) MLLOGF_NAMED(name, ML_NS::ML_Logger::Level::Info, fmt, ##__VA_ARGS__)
@@ -2480,6 +8237,15 @@ namespace mllog_v292
 #define MLLOG_CRITICALF_NAMED(name, fmt, ...) MLLOGF_NAMED(name, ML_NS::ML_Logger::Level::Critical, fmt, ##__VA_ARGS__)
 #define MLLOG_ALERTF_NAMED(name, fmt, ...) MLLOGF_NAMED(name, ML_NS::ML_Logger::Level::Alert, fmt, ##__VA_ARGS__)
 
+#define MLLOG_FMT_NAMED(name, level, fmt, ...) MLLOGFMT_FORMAT(MLLOG_NAMED_LOGGER(name), level, fmt, ##__VA_ARGS__)
+#define MLLOG_DEBUG_FMT_NAMED(name, fmt, ...) MLLOG_FMT_NAMED(name, ML_NS::ML_Logger::Level::Debug, fmt, ##__VA_ARGS__)
+#define MLLOG_INFO_FMT_NAMED(name, fmt, ...) MLLOG_FMT_NAMED(name, ML_NS::ML_Logger::Level::Info, fmt, ##__VA_ARGS__)
+#define MLLOG_NOTICE_FMT_NAMED(name, fmt, ...) MLLOG_FMT_NAMED(name, ML_NS::ML_Logger::Level::Notice, fmt, ##__VA_ARGS__)
+#define MLLOG_WARNING_FMT_NAMED(name, fmt, ...) MLLOG_FMT_NAMED(name, ML_NS::ML_Logger::Level::Warning, fmt, ##__VA_ARGS__)
+#define MLLOG_ERROR_FMT_NAMED(name, fmt, ...) MLLOG_FMT_NAMED(name, ML_NS::ML_Logger::Level::Error, fmt, ##__VA_ARGS__)
+#define MLLOG_CRITICAL_FMT_NAMED(name, fmt, ...) MLLOG_FMT_NAMED(name, ML_NS::ML_Logger::Level::Critical, fmt, ##__VA_ARGS__)
+#define MLLOG_ALERT_FMT_NAMED(name, fmt, ...) MLLOG_FMT_NAMED(name, ML_NS::ML_Logger::Level::Alert, fmt, ##__VA_ARGS__)
+
 /* ===== 可选：旧名导出（仅在不并存多版本时启用） ===== */
 #if defined(MLLOG_LEGACY_GLOBALS) && MLLOG_LEGACY_GLOBALS
 using ML_Logger = ML_NS::ML_Logger;
@@ -0,0 +1,84 @@
+/**
+ * @file mllog_decode.cpp
+ * @brief mllog-decode：把 FileFormat::Binary 写出的二进制日志（.mlb）渲染为文本
+ *
+ * 渲染走 mllog.hpp 内与写入端相同的 pattern 引擎（ML_Logger::decodeBinaryLog），
+ * 默认输出与同配置下文本格式的日志逐字节一致。
+ *
+ * 构建（单文件，无额外依赖）：
+ *   g++ -std=c++17 -O2 -pthread -I.. mllog_decode.cpp -o mllog-decode
+ *   cl /std:c++17 /O2 /EHsc /I.. mllog_decode.cpp /Fe:mllog-decode.exe
+ *   （浮点参数在解码端渲染：请用与写入端相同的语言标准构建，C++17 起为最短往返输出）
+ *
+ * 用法：
+ *   mllog-decode [--pattern "<pattern>"] [file.mlb ...]
+ *   不给文件时读标准输入；--pattern 覆盖文件中记录的 pattern（语法同 setPattern）。
+ */
+#include "mllog.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+static int usage()
+{
+    std::cerr << "usage: mllog-decode [--pattern \"<pattern>\"] [file.mlb ...]\n";
+    return 2;
+}
+
+int main(int argc, char** argv)
+{
+    std::string pattern;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--pattern") == 0 || std::strcmp(argv[i], "-p") == 0)
+        {
+            if (++i >= argc)
+                return usage();
+            pattern = argv[i];
+        }
+        else if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0)
+            return usage();
+        else
+            files.emplace_back(argv[i]);
+    }
+
+    int rc = 0;
+    if (files.empty())
+    {
+#if defined(_WIN32)
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        if (!ML_NS::ML_Logger::decodeBinaryLog(std::cin, std::cout, pattern))
+        {
+            std::cerr << "mllog-decode: <stdin>: not a valid MLLOG binary log or truncated\n";
+            rc = 1;
+        }
+        return rc;
+    }
+    for (const auto& f : files)
+    {
+        std::ifstream in(f, std::ios::binary);
+        if (!in)
+        {
+            std::cerr << "mllog-decode: cannot open " << f << "\n";
+            rc = 1;
+            continue;
+        }
+        if (!ML_NS::ML_Logger::decodeBinaryLog(in, std::cout, pattern))
+        {
+            std::cerr << "mllog-decode: " << f << ": not a valid MLLOG binary log or truncated\n";
+            rc = 1;
+        }
+    }
+    std::cout.flush();
+    return rc;
+}
@@ -0,0 +1,156 @@
+/**
+ * @file mllog_uring_check.cpp
+ * @brief mllog-uring-check：在本机内核上实际经 io_uring 提交写出并校验文件内容（MLLOG_IO_URING 构建自检）
+ *
+ * 覆盖：整块提交与多块在途、小批 pwrite 与在途批次交错、超长写入直写、sync() 的 IO_DRAIN fdatasync、
+ * 追加打开（无 O_APPEND，按偏移写）、以及 ML_Logger 在组提交 + 异步写线程下经 io_uring 的逐行输出。
+ *
+ * 构建与运行（仅 Linux）：
+ *   g++ -std=c++11 -O2 -pthread -DMLLOG_IO_URING=1 -I.. mllog_uring_check.cpp -o mllog-uring-check
+ *   ./mllog-uring-check [dir]        # 默认在 /tmp 下建临时目录
+ * 退出码：0 通过；1 失败；77 内核不支持或禁用 io_uring（跳过）
+ */
+#include "mllog.hpp"
+
+#if !MLLOG_HAS_IO_URING_
+#error "mllog-uring-check: build on Linux with -DMLLOG_IO_URING=1"
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+    std::printf("%s  %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok)
+        ++failures;
+}
+
+static std::string readFile(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// 可辨认的内容：每段带序号，错位/重叠/空洞都会让比对失败
+static std::string chunk(size_t i, size_t n)
+{
+    std::string s;
+    s.reserve(n);
+    while (s.size() < n)
+    {
+        char tmp[32];
+        const int k = std::snprintf(tmp, sizeof(tmp), "[%zu:%zu]", i, s.size());
+        s.append(tmp, (size_t)k);
+    }
+    s.resize(n);
+    return s;
+}
+
+int main(int argc, char** argv)
+{
+    std::string dir = argc > 1 ? argv[1] : std::string();
+    if (dir.empty())
+    {
+        char tmpl[] = "/tmp/mllog-uring-check.XXXXXX";
+        if (!::mkdtemp(tmpl))
+        {
+            std::perror("mkdtemp");
+            return 1;
+        }
+        dir = tmpl;
+    }
+    const std::string path = dir + "/stream.log";
+
+    // 1) 直接驱动 ML_FastOFStream：大小批交错，超过登记块数的批次连续在途
+    std::string expect;
+    {
+        ML_NS::ML_FastOFStream f;
+        f.set_uring(true);
+        f.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!f.is_open())
+        {
+            std::printf("FAIL  open %s\n", path.c_str());
+            return 1;
+        }
+        if (!f.is_uring())
+        {
+            std::printf("skip  io_uring unavailable on this kernel (or disabled)\n");
+            return 77;
+        }
+        const size_t sizes[] = {100, 8192, 70000, 300, 65536, 4096, 4095, 200000, 12, 1u << 20, 50000};
+        for (size_t r = 0; r < 40; ++r)
+        {
+            const std::string s = chunk(r, sizes[r % (sizeof(sizes) / sizeof(sizes[0]))]);
+            f.write(s.data(), s.size());
+            expect += s;
+            if (r % 3 != 2)
+                f.flush(); // 不等待在途的写
+            if (r % 13 == 12)
+                f.sync();
+        }
+        check(f.uring_writes() > 0, "writes were submitted through the ring");
+        check(f.is_uring(), "ring still active after mixed batches");
+        check(!f.bad(), "no write errors");
+        f.close();
+        check(readFile(path) == expect, "stream content matches byte for byte");
+    }
+
+    // 2) 追加打开：偏移从已有长度起
+    {
+        ML_NS::ML_FastOFStream f;
+        f.set_uring(true);
+        f.open(path, std::ios::out | std::ios::app | std::ios::binary);
+        const std::string s = chunk(999, 100000);
+        f.write(s.data(), s.size());
+        f.flush();
+        expect += s;
+        check(f.uring_writes() > 0, "append open submits through the ring");
+        f.close();
+        check(readFile(path) == expect, "append content matches byte for byte");
+    }
+
+    // 3) ML_Logger：异步写线程 + 组提交（每批 fdatasync），逐行校验顺序与完整性（单个分段）
+    {
+        auto& lg = ML_NS::ML_Logger::get("uring-check");
+        lg.setLogFile(dir + "/logger", 3, 64u << 20);
+        lg.setOutput(true, false);
+        lg.setMessageOnly(true);
+        lg.setFileIoUring(true);
+        lg.startAnywhere(false);
+        lg.promoteToFull();
+        lg.setAsync(true);
+        lg.setGroupCommit(true, 256u * 1024u, 1000, true);
+        const int lines = 200000;
+        for (int i = 0; i < lines; ++i)
+            lg.log(__FILE__, __FILE__, __func__, __LINE__, ML_NS::ML_Logger::Level::Info, "line " + std::to_string(i) + " payload xxxxxxxxxxxxxxxxxxxxxxxx");
+        lg.flush();
+        lg.setAsync(false);
+        lg.setFileIoUring(false); // 关闭当前分段：等待在途的写
+
+        std::string content;
+        if (DIR* d = ::opendir(dir.c_str()))
+        {
+            while (dirent* e = ::readdir(d))
+                if (std::strncmp(e->d_name, "logger_", 7) == 0)
+                    content += readFile(dir + "/" + e->d_name);
+            ::closedir(d);
+        }
+        std::string expectLines;
+        for (int i = 0; i < lines; ++i)
+            expectLines += "line " + std::to_string(i) + " payload xxxxxxxxxxxxxxxxxxxxxxxx\n";
+        check(content == expectLines, "logger lines are complete and in order");
+    }
+
+    std::printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}